@@ -38,6 +38,14 @@ dds_StatusKind get_status_kind_from_rmw(rmw_event_type_t event_t);
 RMW_GURUMDDS_CPP_PUBLIC
 bool is_event_supported(rmw_event_type_t event_t);
 
+/// Return true if the input RMW event is reported from a GurumddsMatchedStatus.
+/**
+ * \param event_t input rmw event to check
+ * \return true for the publication and subscription matched events, false otherwise
+ */
+RMW_GURUMDDS_CPP_PUBLIC
+bool is_matched_event(rmw_event_type_t event_t);
+
 /// Assign the input DDS return code to its corresponding RMW return code.
 /**
   * \param dds_return_code input DDS return code
@@ -79,17 +79,23 @@ graph_on_service_deleted(
   const rmw_node_t * const node,
   GurumddsServiceInfo * const svc);
 
+// Clients sharing their endpoints only add them with the first client of the context and
+// associate them once per node, see GurumddsSharedClientEndpoints
 rmw_ret_t
 graph_on_client_created(
   rmw_context_impl_t * const ctx,
   const rmw_node_t * const node,
-  GurumddsClientInfo * const client);
+  GurumddsClientInfo * const client,
+  const bool add_entities = true,
+  const bool associate = true);
 
 rmw_ret_t
 graph_on_client_deleted(
   rmw_context_impl_t * const ctx,
   const rmw_node_t * const node,
-  GurumddsClientInfo * const client);
+  GurumddsClientInfo * const client,
+  const bool remove_entities = true,
+  const bool dissociate = true);
 
 rmw_ret_t
 graph_on_participant_info(rmw_context_impl_t * ctx);
@@ -0,0 +1,44 @@
+// Copyright 2019 GurumNetworks, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef RMW_GURUMDDS_CPP__PUBLISHER_STATISTICS_HPP_
+#define RMW_GURUMDDS_CPP__PUBLISHER_STATISTICS_HPP_
+
+#include <cstdint>
+
+#include "rmw/rmw.h"
+
+#include "rmw_gurumdds_cpp/visibility_control.h"
+
+namespace rmw_gurumdds_cpp
+{
+
+// Counted since the publisher was created
+struct PublisherStatistics
+{
+  // Messages handed to the DataWriter
+  uint64_t written_count;
+  // Messages dropped before serialization, as the publisher is volatile and nothing was matched
+  uint64_t skipped_count;
+};
+
+RMW_GURUMDDS_CPP_PUBLIC
+rmw_ret_t
+get_publisher_statistics(
+  const rmw_publisher_t * publisher,
+  PublisherStatistics * statistics);
+
+}  // namespace rmw_gurumdds_cpp
+
+#endif  // RMW_GURUMDDS_CPP__PUBLISHER_STATISTICS_HPP_
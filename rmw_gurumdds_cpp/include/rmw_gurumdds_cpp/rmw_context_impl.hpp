@@ -39,6 +39,7 @@
 
 #include "rmw_gurumdds_cpp/dds_include.hpp"
 #include "rmw_gurumdds_cpp/identifier.hpp"
+#include "rmw_gurumdds_cpp/types.hpp"
 
 #include "rcutils/strdup.h"
 
@@ -57,6 +58,16 @@ struct rmw_context_impl_s
   bool localhost_only;
   bool service_mapping_basic;
 
+  /* Wait strategy read at init: rmw_wait spins, then yields, then blocks on the wait set. */
+  uint64_t wait_spin_ns{0};
+  uint64_t wait_yield_ns{0};
+
+  /* rmw_take_sequence deserializes a batch on up to this many threads of take_sequence_pool
+     once it holds at least take_sequence_parallel_bytes of samples. */
+  uint64_t take_sequence_threads{1};
+  uint64_t take_sequence_parallel_bytes{0};
+  GurumddsWorkerPool take_sequence_pool;
+
   /* Participant reference count */
   size_t node_count{0};
 
@@ -68,6 +79,10 @@ struct rmw_context_impl_s
 
   std::mutex endpoint_mutex;
 
+  /* Client endpoints shared per service, type and QoS, guarded by endpoint_mutex */
+  bool share_client_endpoints{false};
+  std::map<std::string, struct _GurumddsSharedClientEndpoints *> shared_client_endpoints;
+
   explicit rmw_context_impl_s(rmw_context_t * const base)
   : common_ctx(),
     base(base),
@@ -15,10 +15,14 @@
 #ifndef RMW_GURUMDDS_CPP__RMW_WAIT_HPP_
 #define RMW_GURUMDDS_CPP__RMW_WAIT_HPP_
 
+#include <algorithm>
 #include <chrono>
+#include <cstdint>
+#include <thread>
 #include <unordered_map>
 #include <unordered_set>
 #include <utility>
+#include <vector>
 
 #include "rmw/allocators.h"
 #include "rmw/error_handling.h"
@@ -29,31 +33,46 @@
 #include "rmw_gurumdds_cpp/event_converter.hpp"
 #include "rmw_gurumdds_cpp/types.hpp"
 
-#define CHECK_ATTACH(ret) \
-  if (ret == dds_RETCODE_OK) { \
-    continue; \
-  } else if (ret == dds_RETCODE_OUT_OF_RESOURCES) { \
-    RMW_SET_ERROR_MSG("failed to attach condition to wait set: out of resources"); \
-    return RMW_RET_ERROR; \
-  } else if (ret == dds_RETCODE_BAD_PARAMETER) { \
-    RMW_SET_ERROR_MSG("failed to attach condition to wait set: condition pointer was invalid"); \
-    return RMW_RET_ERROR; \
-  } else { \
-    RMW_SET_ERROR_MSG("failed to attach condition to wait set"); \
-    return RMW_RET_ERROR; \
+bool
+__events_changed(
+  GurumddsWaitSetInfo * wait_set_info,
+  rmw_events_t * events)
+{
+  auto & cached_events = wait_set_info->cached_events;
+  if (!wait_set_info->events_gathered || events->event_count != cached_events.size()) {
+    return true;
+  }
+
+  for (size_t i = 0; i < events->event_count; i++) {
+    auto now = static_cast<rmw_event_t *>(events->events[i]);
+    if (now == nullptr ||
+      cached_events[i].first != static_cast<GurumddsEventInfo *>(now->data) ||
+      cached_events[i].second != now->event_type)
+    {
+      return true;
+    }
   }
 
+  return false;
+}
+
 rmw_ret_t
 __gather_event_conditions(
-  rmw_events_t * events,
-  std::unordered_set<dds_StatusCondition *> & status_conditions)
+  GurumddsWaitSetInfo * wait_set_info,
+  rmw_events_t * events)
 {
   RMW_CHECK_ARGUMENT_FOR_NULL(events, RMW_RET_INVALID_ARGUMENT);
-  std::unordered_map<dds_StatusCondition *, dds_StatusMask> status_map;
+  if (!__events_changed(wait_set_info, events)) {
+    return RMW_RET_OK;
+  }
+
+  std::vector<std::pair<GurumddsEventInfo *, rmw_event_type_t>> cached_events;
+  std::vector<GurumddsWaitSetInfo::EventCondition> event_conditions;
+  std::vector<dds_GuardCondition *> matched_conditions;
 
   for (size_t i = 0; i < events->event_count; i++) {
     auto now = static_cast<rmw_event_t *>(events->events[i]);
-    RMW_CHECK_ARGUMENT_FOR_NULL(events, RMW_RET_INVALID_ARGUMENT);
+    RMW_CHECK_ARGUMENT_FOR_NULL(now, RMW_RET_INVALID_ARGUMENT);
 
     auto event_info = static_cast<GurumddsEventInfo *>(now->data);
     if (event_info == nullptr) {
@@ -67,20 +86,58 @@ __gather_event_conditions(
       return RMW_RET_ERROR;
     }
 
-    if (is_event_supported(now->event_type)) {
-      auto map_pair = status_map.insert(std::make_pair(status_condition, 0));
-      auto it = map_pair.first;
-      status_map[status_condition] = get_status_kind_from_rmw(now->event_type) | it->second;
+    cached_events.emplace_back(event_info, now->event_type);
+
+    if (is_matched_event(now->event_type)) {
+      dds_GuardCondition * matched_condition = event_info->get_matched_status()->get_condition();
+      if (matched_condition == nullptr) {
+        RMW_SET_ERROR_MSG("failed to get matched condition");
+        return RMW_RET_ERROR;
+      }
+      if (std::find(
+          matched_conditions.begin(), matched_conditions.end(),
+          matched_condition) == matched_conditions.end())
+      {
+        matched_conditions.push_back(matched_condition);
+      }
+    } else if (is_event_supported(now->event_type)) {
+      auto it = std::find_if(
+        event_conditions.begin(), event_conditions.end(),
+        [event_info](const GurumddsWaitSetInfo::EventCondition & entry) {
+          return entry.event_info == event_info;
+        });
+      if (it == event_conditions.end()) {
+        event_conditions.push_back(
+          {event_info, status_condition, get_status_kind_from_rmw(now->event_type)});
+      } else {
+        it->mask |= get_status_kind_from_rmw(now->event_type);
+      }
     } else {
       RMW_SET_ERROR_MSG_WITH_FORMAT_STRING("unsupported event: %d", now->event_type);
     }
   }
 
-  for (auto & map_pair : status_map) {
-    dds_StatusCondition_set_enabled_statuses(map_pair.first, map_pair.second);
-    status_conditions.insert(map_pair.first);
+  // Withdraw from the status conditions this wait set no longer waits on, then enable the
+  // statuses it waits for now alongside those of the other wait sets
+  for (auto & old_condition : wait_set_info->event_conditions) {
+    auto it = std::find_if(
+      event_conditions.begin(), event_conditions.end(),
+      [&old_condition](const GurumddsWaitSetInfo::EventCondition & entry) {
+        return entry.event_info == old_condition.event_info;
+      });
+    if (it == event_conditions.end()) {
+      old_condition.event_info->set_wait_set_statuses(wait_set_info, 0);
+    }
+  }
+  for (auto & event_condition : event_conditions) {
+    event_condition.event_info->set_wait_set_statuses(wait_set_info, event_condition.mask);
   }
 
+  wait_set_info->cached_events = std::move(cached_events);
+  wait_set_info->event_conditions = std::move(event_conditions);
+  wait_set_info->matched_conditions = std::move(matched_conditions);
+  wait_set_info->events_gathered = true;
+
   return RMW_RET_OK;
 }
 
@@ -130,6 +187,141 @@ rmw_ret_t __detach_condition(
   return RMW_RET_OK;
 }
 
+rmw_ret_t __request_condition(
+  GurumddsWaitSetInfo * wait_set_info,
+  dds_Condition * condition)
+{
+  auto it = wait_set_info->attached.find(condition);
+  if (it != wait_set_info->attached.end()) {
+    it->second.requested = wait_set_info->generation;
+    return RMW_RET_OK;
+  }
+
+  dds_ReturnCode_t ret = dds_WaitSet_attach_condition(wait_set_info->wait_set, condition);
+  if (ret == dds_RETCODE_OUT_OF_RESOURCES) {
+    RMW_SET_ERROR_MSG("failed to attach condition to wait set: out of resources");
+    return RMW_RET_ERROR;
+  } else if (ret == dds_RETCODE_BAD_PARAMETER) {
+    RMW_SET_ERROR_MSG("failed to attach condition to wait set: condition pointer was invalid");
+    return RMW_RET_ERROR;
+  } else if (ret != dds_RETCODE_OK) {
+    RMW_SET_ERROR_MSG("failed to attach condition to wait set");
+    return RMW_RET_ERROR;
+  }
+
+  GurumddsWaitSetInfo::AttachedCondition attached_condition;
+  attached_condition.requested = wait_set_info->generation;
+  attached_condition.triggered = 0;
+  wait_set_info->attached.emplace(condition, attached_condition);
+  return RMW_RET_OK;
+}
+
+rmw_ret_t __detach_stale_conditions(GurumddsWaitSetInfo * wait_set_info)
+{
+  auto it = wait_set_info->attached.begin();
+  while (it != wait_set_info->attached.end()) {
+    if (it->second.requested == wait_set_info->generation) {
+      ++it;
+      continue;
+    }
+
+    rmw_ret_t rmw_ret_code = __detach_condition(wait_set_info->wait_set, it->first);
+    if (rmw_ret_code != RMW_RET_OK) {
+      return rmw_ret_code;
+    }
+    it = wait_set_info->attached.erase(it);
+  }
+
+  return RMW_RET_OK;
+}
+
+void __mark_triggered_conditions(
+  GurumddsWaitSetInfo * wait_set_info,
+  dds_ConditionSeq * active_conditions)
+{
+  for (uint32_t i = 0; i < dds_ConditionSeq_length(active_conditions); ++i) {
+    auto it = wait_set_info->attached.find(dds_ConditionSeq_get(active_conditions, i));
+    if (it != wait_set_info->attached.end()) {
+      it->second.triggered = wait_set_info->generation;
+    }
+  }
+}
+
+bool __is_triggered(
+  GurumddsWaitSetInfo * wait_set_info,
+  dds_Condition * condition)
+{
+  auto it = wait_set_info->attached.find(condition);
+  return it != wait_set_info->attached.end() &&
+         it->second.triggered == wait_set_info->generation;
+}
+
+// Polls the wait set for up to spin_ns + yield_ns, yielding the CPU once spin_ns has passed,
+// and then blocks on it for the rest of the timeout.
+dds_ReturnCode_t __wait_for_conditions(
+  GurumddsWaitSetInfo * wait_set_info,
+  const rmw_time_t * wait_timeout)
+{
+  dds_Duration_t timeout;
+  if (wait_timeout == nullptr) {
+    timeout.sec = dds_DURATION_INFINITE_SEC;
+    timeout.nanosec = dds_DURATION_ZERO_NSEC;
+  } else {
+    timeout.sec = static_cast<int32_t>(wait_timeout->sec);
+    timeout.nanosec = static_cast<uint32_t>(wait_timeout->nsec);
+  }
+
+  const uint64_t poll_ns = wait_set_info->spin_ns + wait_set_info->yield_ns;
+  const bool no_wait =
+    wait_timeout != nullptr && wait_timeout->sec == 0 && wait_timeout->nsec == 0;
+  if (poll_ns == 0 || no_wait) {
+    return dds_WaitSet_wait(wait_set_info->wait_set, wait_set_info->active_conditions, &timeout);
+  }
+
+  // Timeouts beyond the polling budget only matter for the blocking wait
+  uint64_t timeout_ns = UINT64_MAX;
+  if (wait_timeout != nullptr && wait_timeout->sec < poll_ns / 1000000000ULL + 1) {
+    timeout_ns = wait_timeout->sec * 1000000000ULL + wait_timeout->nsec;
+  }
+  const std::chrono::nanoseconds spin_budget(wait_set_info->spin_ns);
+  const std::chrono::nanoseconds poll_budget(std::min(poll_ns, timeout_ns));
+
+  dds_Duration_t zero_timeout;
+  zero_timeout.sec = 0;
+  zero_timeout.nanosec = 0;
+
+  const auto start = std::chrono::steady_clock::now();
+  std::chrono::nanoseconds elapsed(0);
+  while (true) {
+    dds_ReturnCode_t ret = dds_WaitSet_wait(
+      wait_set_info->wait_set, wait_set_info->active_conditions, &zero_timeout);
+    if (ret != dds_RETCODE_TIMEOUT) {
+      return ret;
+    }
+
+    elapsed = std::chrono::steady_clock::now() - start;
+    if (elapsed >= poll_budget) {
+      break;
+    }
+
+    if (elapsed >= spin_budget) {
+      std::this_thread::yield();
+    }
+  }
+
+  if (timeout_ns != UINT64_MAX) {
+    const uint64_t elapsed_ns = static_cast<uint64_t>(elapsed.count());
+    if (elapsed_ns >= timeout_ns) {
+      return dds_RETCODE_TIMEOUT;
+    }
+    const uint64_t remaining_ns = timeout_ns - elapsed_ns;
+    timeout.sec = static_cast<int32_t>(remaining_ns / 1000000000ULL);
+    timeout.nanosec = static_cast<uint32_t>(remaining_ns % 1000000000ULL);
+  }
+
+  return dds_WaitSet_wait(wait_set_info->wait_set, wait_set_info->active_conditions, &timeout);
+}
+
 template<typename SubscriberInfo, typename ServiceInfo, typename ClientInfo>
 rmw_ret_t
 __rmw_wait(
@@ -142,64 +334,6 @@ __rmw_wait(
   rmw_wait_set_t * wait_set,
   const rmw_time_t * wait_timeout)
 {
-  (void)events;
-  struct atexit_t
-  {
-    ~atexit_t()
-    {
-      if (wait_set == nullptr) {
-        RMW_SET_ERROR_MSG("wait set handle is null");
-        return;
-      }
-
-      RMW_CHECK_TYPE_IDENTIFIERS_MATCH(
-        wait set handle, wait_set->implementation_identifier,
-        implementation_identifier, return );
-
-      GurumddsWaitSetInfo * wait_set_info = static_cast<GurumddsWaitSetInfo *>(wait_set->data);
-      if (wait_set_info == nullptr) {
-        RMW_SET_ERROR_MSG("WaitSet implementation struct is null");
-        return;
-      }
-
-      dds_WaitSet * dds_wait_set = static_cast<dds_WaitSet *>(wait_set_info->wait_set);
-      if (dds_wait_set == nullptr) {
-        RMW_SET_ERROR_MSG("DDS wait set handle is null");
-        return;
-      }
-
-      dds_ConditionSeq * attached_conditions =
-        static_cast<dds_ConditionSeq *>(wait_set_info->attached_conditions);
-      if (attached_conditions == nullptr) {
-        RMW_SET_ERROR_MSG("DDS condition sequence handle is null");
-        return;
-      }
-
-      dds_ReturnCode_t ret = dds_WaitSet_get_conditions(dds_wait_set, attached_conditions);
-      if (ret != dds_RETCODE_OK) {
-        RMW_SET_ERROR_MSG("failed to get attached conditions for wait set");
-        return;
-      }
-
-      for (uint32_t i = 0; i < dds_ConditionSeq_length(attached_conditions); ++i) {
-        ret = dds_WaitSet_detach_condition(
-          dds_wait_set, dds_ConditionSeq_get(attached_conditions, i));
-        if (ret != dds_RETCODE_OK) {
-          RMW_SET_ERROR_MSG("failed to detach condition from wait set");
-        }
-      }
-
-      while (dds_ConditionSeq_length(attached_conditions) > 0) {
-        dds_ConditionSeq_remove(attached_conditions, 0);
-      }
-    }
-    rmw_wait_set_t * wait_set = nullptr;
-    const char * implementation_identifier = nullptr;
-  } atexit;
-
-  atexit.wait_set = wait_set;
-  atexit.implementation_identifier = implementation_identifier;
-
   RMW_CHECK_ARGUMENT_FOR_NULL(wait_set, RMW_RET_INVALID_ARGUMENT);
   RMW_CHECK_TYPE_IDENTIFIERS_MATCH(
     wait set handle, wait_set->implementation_identifier,
@@ -224,6 +358,9 @@ __rmw_wait(
     return RMW_RET_ERROR;
   }
 
+  std::unique_lock<std::mutex> attached_lock(wait_set_info->attached_mutex);
+  ++wait_set_info->generation;
+
   if (subscriptions != nullptr) {
     for (size_t i = 0; i < subscriptions->subscriber_count; ++i) {
       SubscriberInfo * subscriber_info =
@@ -239,24 +376,33 @@ __rmw_wait(
         return RMW_RET_ERROR;
       }
 
-      dds_ReturnCode_t ret = dds_WaitSet_attach_condition(
-        dds_wait_set, reinterpret_cast<dds_Condition *>(read_condition));
-      CHECK_ATTACH(ret);
+      rmw_ret_t rmw_ret_code = __request_condition(
+        wait_set_info, reinterpret_cast<dds_Condition *>(read_condition));
+      if (rmw_ret_code != RMW_RET_OK) {
+        return rmw_ret_code;
+      }
     }
   }
 
-  std::unordered_set<dds_StatusCondition *> status_conditions;
-
-  rmw_ret_t ret_code = __gather_event_conditions(events, status_conditions);
+  rmw_ret_t ret_code = __gather_event_conditions(wait_set_info, events);
   if (ret_code != RMW_RET_OK) {
     return ret_code;
   }
 
-  for (auto status_condition : status_conditions) {
-    dds_ReturnCode_t ret = dds_WaitSet_attach_condition(
-      dds_wait_set,
-      reinterpret_cast<dds_Condition *>(status_condition));
-    CHECK_ATTACH(ret);
+  for (auto & event_condition : wait_set_info->event_conditions) {
+    ret_code = __request_condition(
+      wait_set_info, reinterpret_cast<dds_Condition *>(event_condition.condition));
+    if (ret_code != RMW_RET_OK) {
+      return ret_code;
+    }
+  }
+
+  for (auto matched_condition : wait_set_info->matched_conditions) {
+    ret_code = __request_condition(
+      wait_set_info, reinterpret_cast<dds_Condition *>(matched_condition));
+    if (ret_code != RMW_RET_OK) {
+      return ret_code;
+    }
   }
 
   if (guard_conditions != nullptr) {
@@ -268,9 +414,11 @@ __rmw_wait(
         return RMW_RET_ERROR;
       }
 
-      dds_ReturnCode_t ret = dds_WaitSet_attach_condition(
-        dds_wait_set, reinterpret_cast<dds_Condition *>(guard_condition));
-      CHECK_ATTACH(ret);
+      rmw_ret_t rmw_ret_code = __request_condition(
+        wait_set_info, reinterpret_cast<dds_Condition *>(guard_condition));
+      if (rmw_ret_code != RMW_RET_OK) {
+        return rmw_ret_code;
+      }
     }
   }
 
@@ -288,9 +436,11 @@ __rmw_wait(
         return RMW_RET_ERROR;
       }
 
-      dds_ReturnCode_t ret = dds_WaitSet_attach_condition(
-        dds_wait_set, reinterpret_cast<dds_Condition *>(read_condition));
-      CHECK_ATTACH(ret);
+      rmw_ret_t rmw_ret_code = __request_condition(
+        wait_set_info, reinterpret_cast<dds_Condition *>(read_condition));
+      if (rmw_ret_code != RMW_RET_OK) {
+        return rmw_ret_code;
+      }
     }
   }
 
@@ -302,105 +452,43 @@ __rmw_wait(
         return RMW_RET_ERROR;
       }
 
-      dds_ReadCondition * read_condition = client_info->read_condition;
-      if (read_condition == nullptr) {
+      // Clients sharing their endpoints are woken by their own response queue
+      dds_Condition * condition = client_info->response_condition != nullptr ?
+        reinterpret_cast<dds_Condition *>(client_info->response_condition) :
+        reinterpret_cast<dds_Condition *>(client_info->read_condition);
+      if (condition == nullptr) {
         RMW_SET_ERROR_MSG("read condition handle is null");
         return RMW_RET_ERROR;
       }
 
-      dds_ReturnCode_t ret = dds_WaitSet_attach_condition(
-        dds_wait_set, reinterpret_cast<dds_Condition *>(read_condition));
-      CHECK_ATTACH(ret);
+      rmw_ret_t rmw_ret_code = __request_condition(wait_set_info, condition);
+      if (rmw_ret_code != RMW_RET_OK) {
+        return rmw_ret_code;
+      }
     }
   }
 
-  rmw_ret_t rret = RMW_RET_OK;
-
-  const char * env_name = "RMW_GURUMDDS_WAIT_USE_POLLING";
-  char * env_value = nullptr;
-  bool use_polling = false;
-
-  env_value = getenv(env_name);
-  if (env_value != nullptr) {
-    use_polling = (strcmp(env_value, "1") == 0);
+  ret_code = __detach_stale_conditions(wait_set_info);
+  if (ret_code != RMW_RET_OK) {
+    return ret_code;
   }
+  attached_lock.unlock();
 
-  if (!use_polling) {  // Default: use dds_WaitSet_wait()
-    dds_Duration_t timeout;
-    if (wait_timeout == nullptr) {
-      timeout.sec = dds_DURATION_INFINITE_SEC;
-      timeout.nanosec = dds_DURATION_ZERO_NSEC;
-    } else {
-      timeout.sec = static_cast<int32_t>(wait_timeout->sec);
-      timeout.nanosec = static_cast<uint32_t>(wait_timeout->nsec);
-    }
-
-    dds_ReturnCode_t status = dds_WaitSet_wait(dds_wait_set, active_conditions, &timeout);
-    if (status != dds_RETCODE_OK && status != dds_RETCODE_TIMEOUT) {
-      RMW_SET_ERROR_MSG("failed to wait on wait set");
-      return RMW_RET_ERROR;
-    }
-
-    if (status == dds_RETCODE_TIMEOUT) {
-      rret = RMW_RET_TIMEOUT;
-    }
-  } else {  // use polilng
-    uint64_t sec, nsec;
-    bool inf = false;
-    if (wait_timeout != nullptr) {
-      sec = wait_timeout->sec;
-      nsec = wait_timeout->nsec;
-      inf = false;
-    } else {
-      sec = 0;
-      nsec = 0;
-      inf = true;
-    }
-    auto t = std::chrono::steady_clock::now() +
-      std::chrono::nanoseconds(sec * 1000000000ULL + nsec);
-    bool triggered = false;
-
-    while (dds_ConditionSeq_length(active_conditions) > 0) {
-      dds_ConditionSeq_remove(active_conditions, 0);
-    }
-
-    dds_ConditionSeq * conds = dds_ConditionSeq_create(8);
-    dds_WaitSet_get_conditions(dds_wait_set, conds);
-
-    for (uint32_t i = 0; i < dds_ConditionSeq_length(conds); ++i) {
-      dds_Condition * cond = dds_ConditionSeq_get(conds, i);
-      if (cond == NULL) {
-        continue;
-      }
-
-      if (dds_Condition_get_trigger_value(cond) == true) {
-        dds_ConditionSeq_add(active_conditions, cond);
-        triggered = true;
-      }
-    }
-
-    for (uint32_t i = 0; (inf || std::chrono::steady_clock::now() <= t) && !triggered; ++i) {
-      if (i >= dds_ConditionSeq_length(conds)) {
-        i = 0;
-      }
-
-      dds_Condition * cond = dds_ConditionSeq_get(conds, i);
-      if (cond == NULL) {
-        continue;
-      }
+  rmw_ret_t rret = RMW_RET_OK;
 
-      if (dds_Condition_get_trigger_value(cond) == true) {
-        dds_ConditionSeq_add(active_conditions, cond);
-        triggered = true;
-      }
-    }
-    dds_ConditionSeq_delete(conds);
+  dds_ReturnCode_t status = __wait_for_conditions(wait_set_info, wait_timeout);
+  if (status != dds_RETCODE_OK && status != dds_RETCODE_TIMEOUT) {
+    RMW_SET_ERROR_MSG("failed to wait on wait set");
+    return RMW_RET_ERROR;
+  }
 
-    if (!triggered) {
-      rret = RMW_RET_TIMEOUT;
-    }
+  if (status == dds_RETCODE_TIMEOUT) {
+    rret = RMW_RET_TIMEOUT;
   }
 
+  attached_lock.lock();
+  __mark_triggered_conditions(wait_set_info, active_conditions);
+
   if (subscriptions != nullptr) {
     for (size_t i = 0; i < subscriptions->subscriber_count; ++i) {
       SubscriberInfo * subscriber_info =
@@ -416,25 +504,9 @@ __rmw_wait(
         return RMW_RET_ERROR;
       }
 
-      uint32_t j = 0;
-      for (; j < dds_ConditionSeq_length(active_conditions); ++j) {
-        if (
-          dds_ConditionSeq_get(active_conditions, j) ==
-          reinterpret_cast<dds_Condition *>(read_condition))
-        {
-          break;
-        }
-      }
-
-      if (j >= dds_ConditionSeq_length(active_conditions)) {
+      if (!__is_triggered(wait_set_info, reinterpret_cast<dds_Condition *>(read_condition))) {
         subscriptions->subscribers[i] = 0;
       }
-
-      rmw_ret_t rmw_ret_code = __detach_condition(
-        dds_wait_set, reinterpret_cast<dds_Condition *>(read_condition));
-      if (rmw_ret_code != RMW_RET_OK) {
-        return rmw_ret_code;
-      }
     }
   }
 
@@ -447,27 +519,16 @@ __rmw_wait(
         return RMW_RET_ERROR;
       }
 
-      uint32_t j = 0;
-      for (; j < dds_ConditionSeq_length(active_conditions); ++j) {
-        if (dds_ConditionSeq_get(active_conditions, j) == condition) {
-          dds_GuardCondition * guard = reinterpret_cast<dds_GuardCondition *>(condition);
-          dds_ReturnCode_t ret = dds_GuardCondition_set_trigger_value(guard, false);
-          if (ret != dds_RETCODE_OK) {
-            RMW_SET_ERROR_MSG("failed to set trigger value");
-            return RMW_RET_ERROR;
-          }
-          break;
+      if (__is_triggered(wait_set_info, condition)) {
+        dds_GuardCondition * guard = reinterpret_cast<dds_GuardCondition *>(condition);
+        dds_ReturnCode_t ret = dds_GuardCondition_set_trigger_value(guard, false);
+        if (ret != dds_RETCODE_OK) {
+          RMW_SET_ERROR_MSG("failed to set trigger value");
+          return RMW_RET_ERROR;
         }
-      }
-
-      if (j >= dds_ConditionSeq_length(active_conditions)) {
+      } else {
         guard_conditions->guard_conditions[i] = 0;
       }
-
-      rmw_ret_t rmw_ret_code = __detach_condition(dds_wait_set, condition);
-      if (rmw_ret_code != RMW_RET_OK) {
-        return rmw_ret_code;
-      }
     }
   }
 
@@ -485,25 +546,9 @@ __rmw_wait(
         return RMW_RET_ERROR;
       }
 
-      uint32_t j = 0;
-      for (; j < dds_ConditionSeq_length(active_conditions); ++j) {
-        if (
-          dds_ConditionSeq_get(active_conditions, j) ==
-          reinterpret_cast<dds_Condition *>(read_condition))
-        {
-          break;
-        }
-      }
-
-      if (j >= dds_ConditionSeq_length(active_conditions)) {
+      if (!__is_triggered(wait_set_info, reinterpret_cast<dds_Condition *>(read_condition))) {
         services->services[i] = 0;
       }
-
-      rmw_ret_t rmw_ret_code = __detach_condition(
-        dds_wait_set, reinterpret_cast<dds_Condition *>(read_condition));
-      if (rmw_ret_code != RMW_RET_OK) {
-        return rmw_ret_code;
-      }
     }
   }
 
@@ -515,31 +560,17 @@ __rmw_wait(
         return RMW_RET_ERROR;
       }
 
-      dds_ReadCondition * read_condition = client_info->read_condition;
-      if (read_condition == nullptr) {
+      dds_Condition * condition = client_info->response_condition != nullptr ?
+        reinterpret_cast<dds_Condition *>(client_info->response_condition) :
+        reinterpret_cast<dds_Condition *>(client_info->read_condition);
+      if (condition == nullptr) {
         RMW_SET_ERROR_MSG("read condition handle is null");
         return RMW_RET_ERROR;
       }
 
-      uint32_t j = 0;
-      for (; j < dds_ConditionSeq_length(active_conditions); ++j) {
-        if (
-          dds_ConditionSeq_get(active_conditions, j) ==
-          reinterpret_cast<dds_Condition *>(read_condition))
-        {
-          break;
-        }
-      }
-
-      if (j >= dds_ConditionSeq_length(active_conditions)) {
+      if (!__is_triggered(wait_set_info, condition)) {
         clients->clients[i] = 0;
       }
-
-      rmw_ret_t rmw_ret_code = __detach_condition(
-        dds_wait_set, reinterpret_cast<dds_Condition *>(read_condition));
-      if (rmw_ret_code != RMW_RET_OK) {
-        return rmw_ret_code;
-      }
     }
   }
 
@@ -0,0 +1,62 @@
+// Copyright 2019 GurumNetworks, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef RMW_GURUMDDS_CPP__SERIALIZED_LOAN_HPP_
+#define RMW_GURUMDDS_CPP__SERIALIZED_LOAN_HPP_
+
+#include "rmw/rmw.h"
+
+#include "rmw_gurumdds_cpp/visibility_control.h"
+
+namespace rmw_gurumdds_cpp
+{
+
+// Takes up to count serialized messages without copying them out of the DataReader.
+// The first *taken entries of serialized_messages, which must be zero initialized, point into
+// samples loaned from DDS. They carry no allocator and stay valid until the whole array is
+// handed back to return_serialized_message_loans. message_infos may be null.
+RMW_GURUMDDS_CPP_PUBLIC
+rmw_ret_t
+take_serialized_message_loans(
+  const rmw_subscription_t * subscription,
+  size_t count,
+  rmw_serialized_message_t * serialized_messages,
+  rmw_message_info_t * message_infos,
+  size_t * taken);
+
+// Returns every loan of one take_serialized_message_loans call and zero initializes them
+RMW_GURUMDDS_CPP_PUBLIC
+rmw_ret_t
+return_serialized_message_loans(
+  const rmw_subscription_t * subscription,
+  rmw_serialized_message_t * serialized_messages,
+  size_t count);
+
+RMW_GURUMDDS_CPP_PUBLIC
+rmw_ret_t
+take_serialized_message_loan(
+  const rmw_subscription_t * subscription,
+  rmw_serialized_message_t * serialized_message,
+  bool * taken,
+  rmw_message_info_t * message_info);
+
+RMW_GURUMDDS_CPP_PUBLIC
+rmw_ret_t
+return_serialized_message_loan(
+  const rmw_subscription_t * subscription,
+  rmw_serialized_message_t * serialized_message);
+
+}  // namespace rmw_gurumdds_cpp
+
+#endif  // RMW_GURUMDDS_CPP__SERIALIZED_LOAN_HPP_
@@ -15,25 +15,39 @@
 #ifndef RMW_GURUMDDS_CPP__TYPES_HPP_
 #define RMW_GURUMDDS_CPP__TYPES_HPP_
 
+#include <array>
 #include <atomic>
 #include <cassert>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
 #include <exception>
+#include <functional>
 #include <iostream>
 #include <limits>
 #include <list>
 #include <map>
+#include <memory>
 #include <mutex>
 #include <set>
 #include <sstream>
 #include <stdexcept>
 #include <string>
+#include <thread>
+#include <unordered_map>
 #include <utility>
+#include <vector>
 
+#include "rmw/event.h"
+#include "rmw/event_callback_type.h"
 #include "rmw/ret_types.h"
 
 #include "rmw_gurumdds_cpp/dds_include.hpp"
 #include "rmw_gurumdds_cpp/visibility_control.h"
 
+class SerializationPlan;
+struct _GurumddsSharedClientEndpoints;
+
 void on_participant_changed(
   const dds_DomainParticipant * a_participant,
   const dds_ParticipantBuiltinTopicData * data,
@@ -49,12 +63,174 @@ void on_subscription_changed(
   const dds_SubscriptionBuiltinTopicData * data,
   dds_InstanceHandle_t handle);
 
-typedef struct _GurumddsWaitSetInfo
+// Sequences handed to the raw take calls of a reader. They are created along with the entity
+// and reused by every take, so that a take only borrows and returns DDS loans.
+typedef struct _GurumddsTakeSequences
 {
-  dds_WaitSet * wait_set;
-  dds_ConditionSeq * active_conditions;
-  dds_ConditionSeq * attached_conditions;
-} GurumddsWaitSetInfo;
+  _GurumddsTakeSequences() = default;
+  _GurumddsTakeSequences(const _GurumddsTakeSequences &) = delete;
+  _GurumddsTakeSequences & operator=(const _GurumddsTakeSequences &) = delete;
+  ~_GurumddsTakeSequences();
+
+  bool init(uint32_t a_length);
+  void fini();
+
+  std::mutex mutex;
+  uint32_t length = 0;
+  dds_DataSeq * data_values = nullptr;
+  dds_SampleInfoSeq * sample_infos = nullptr;
+  dds_UnsignedLongSeq * sample_sizes = nullptr;
+} GurumddsTakeSequences;
+
+// A valid sample of a batch taken by rmw_take_sequence and the message it is deserialized into
+typedef struct _GurumddsTakenSample
+{
+  void * sample;
+  size_t sample_size;
+  void * ros_message;
+} GurumddsTakenSample;
+
+// Samples the data available listeners read per call while counting new samples
+#define RMW_GURUMDDS_LISTENER_READ_LENGTH 32
+
+// Grants a single take exclusive use of an entity's take sequences. A take that races with
+// another one on the same entity gets temporary sequences of the same length instead of
+// blocking.
+class TakeSequencesGuard
+{
+public:
+  explicit TakeSequencesGuard(GurumddsTakeSequences & shared);
+  TakeSequencesGuard(const TakeSequencesGuard &) = delete;
+  TakeSequencesGuard & operator=(const TakeSequencesGuard &) = delete;
+
+  bool is_valid() const
+  {
+    return data_values != nullptr;
+  }
+
+  uint32_t length;
+  dds_DataSeq * data_values;
+  dds_SampleInfoSeq * sample_infos;
+  dds_UnsignedLongSeq * sample_sizes;
+
+private:
+  std::unique_lock<std::mutex> lock;
+  GurumddsTakeSequences temporary;
+};
+
+// Recycled storage for messages lent to the user. Each block reserves header_size bytes in front
+// of the message, the last CDR_HEADER_SIZE of which can hold a CDR header, so that a message
+// whose layout matches CDR is handed to DDS straight from its block.
+class GurumddsLoanPool
+{
+public:
+  static constexpr size_t header_size = alignof(std::max_align_t);
+
+  GurumddsLoanPool() = default;
+  GurumddsLoanPool(const GurumddsLoanPool &) = delete;
+  GurumddsLoanPool & operator=(const GurumddsLoanPool &) = delete;
+  ~GurumddsLoanPool();
+
+  void init(size_t a_message_size);
+  void * acquire();
+  void release(void * message);
+
+private:
+  std::mutex mutex;
+  size_t message_size = 0;
+  std::vector<uint8_t *> free_blocks;
+};
+
+// Threads that run batches of tasks for a context, started on first use and stopped by
+// shutdown(). The calling thread works on its own batch too, so a batch of n tasks is spread
+// over at most n threads without waiting for an idle pool.
+class GurumddsWorkerPool
+{
+public:
+  GurumddsWorkerPool() = default;
+  GurumddsWorkerPool(const GurumddsWorkerPool &) = delete;
+  GurumddsWorkerPool & operator=(const GurumddsWorkerPool &) = delete;
+  ~GurumddsWorkerPool();
+
+  // Runs every task and returns once all of them are done. thread_count is the number of
+  // threads a batch may use including the caller, and only matters to the first batch.
+  void run(const std::vector<std::function<void()>> & tasks, size_t thread_count);
+  void shutdown();
+
+private:
+  struct Batch
+  {
+    const std::vector<std::function<void()>> * tasks;
+    size_t next;
+    size_t done;
+  };
+
+  // Claims the next task of batch and runs it, returns false when every task was claimed
+  bool run_next(std::unique_lock<std::mutex> & lock, Batch & batch);
+  void work();
+
+  std::mutex mutex;
+  std::condition_variable work_condition;
+  std::condition_variable done_condition;
+  std::deque<Batch *> batches;
+  std::vector<std::thread> threads;
+  bool started = false;
+  bool stopping = false;
+};
+
+// Callback set through the rmw set_on_new_*_callback functions. Notifications that arrive while
+// no callback is set are counted and reported to the next callback that is set.
+class GurumddsEventCallback
+{
+public:
+  GurumddsEventCallback() = default;
+  GurumddsEventCallback(const GurumddsEventCallback &) = delete;
+  GurumddsEventCallback & operator=(const GurumddsEventCallback &) = delete;
+
+  void set(rmw_event_callback_t a_callback, const void * a_user_data);
+  void notify(size_t count);
+
+private:
+  std::mutex mutex;
+  rmw_event_callback_t callback = nullptr;
+  const void * user_data = nullptr;
+  size_t unread_count = 0;
+};
+
+// Matched status of a DataWriter or DataReader, kept by its matched status listener. The
+// listener consumes the DDS status, so matched events are taken from here, and condition stays
+// triggered while there are changes that were not taken yet.
+class GurumddsMatchedStatus
+{
+public:
+  GurumddsMatchedStatus() = default;
+  GurumddsMatchedStatus(const GurumddsMatchedStatus &) = delete;
+  GurumddsMatchedStatus & operator=(const GurumddsMatchedStatus &) = delete;
+  ~GurumddsMatchedStatus();
+
+  bool init();
+  void update(int32_t total_count, int32_t current_count);
+  void take(rmw_matched_status_t * status);
+  bool has_changes();
+
+  int32_t current_count() const
+  {
+    return current.load(std::memory_order_relaxed);
+  }
+
+  dds_GuardCondition * get_condition() const
+  {
+    return condition;
+  }
+
+private:
+  std::mutex mutex;
+  std::atomic<int32_t> current{0};
+  int32_t total = 0;
+  int32_t taken_total = 0;
+  int32_t taken_current = 0;
+  dds_GuardCondition * condition = nullptr;
+};
 
 typedef struct _GurumddsEventInfo
 {
@@ -62,22 +238,97 @@ typedef struct _GurumddsEventInfo
   virtual rmw_ret_t get_status(const dds_StatusMask mask, void * event) = 0;
   virtual dds_StatusCondition * get_statuscondition() = 0;
   virtual dds_StatusMask get_status_changes() = 0;
+  virtual GurumddsMatchedStatus * get_matched_status() = 0;
+
+  // Sets the status kinds wait_set waits for, 0 once it no longer does. The status condition is
+  // shared by every wait set, so it enables the union of them.
+  void set_wait_set_statuses(const void * wait_set, dds_StatusMask mask);
+
+  std::mutex wait_set_statuses_mutex;
+  std::vector<std::pair<const void *, dds_StatusMask>> wait_set_statuses;
+  dds_StatusMask enabled_statuses = 0;
+  bool enabled_statuses_applied = false;
 } GurumddsEventInfo;
 
+typedef struct _GurumddsWaitSetInfo
+{
+  dds_WaitSet * wait_set;
+  dds_ConditionSeq * active_conditions;
+  dds_ConditionSeq * attached_conditions;
+
+  // Conditions attached to wait_set, tagged with the last wait that requested them and the
+  // last wait they were active in. rmw_wait only attaches and detaches the difference between
+  // consecutive calls, and looks up its results here instead of scanning active_conditions.
+  struct AttachedCondition
+  {
+    uint64_t requested;
+    uint64_t triggered;
+  };
+  std::mutex attached_mutex;
+  std::unordered_map<dds_Condition *, AttachedCondition> attached;
+  uint64_t generation;
+
+  // Events passed to the last rmw_wait and the status conditions and masks derived from them.
+  // The masks are only recomputed and applied when the events change, or when an entity they
+  // came from is destroyed and events_gathered is cleared.
+  std::vector<std::pair<GurumddsEventInfo *, rmw_event_type_t>> cached_events;
+  bool events_gathered = false;
+  struct EventCondition
+  {
+    GurumddsEventInfo * event_info;
+    dds_StatusCondition * condition;
+    dds_StatusMask mask;
+  };
+  std::vector<EventCondition> event_conditions;
+  // Matched events wait on the conditions of their GurumddsMatchedStatus instead
+  std::vector<dds_GuardCondition *> matched_conditions;
+
+  // Polling budgets copied from the context wait strategy
+  uint64_t spin_ns;
+  uint64_t yield_ns;
+} GurumddsWaitSetInfo;
+
+// Detaches a condition that is about to be deleted from every wait set still holding it
+void wait_sets_forget_condition(dds_Condition * condition);
+
 typedef struct _GurumddsPublisherInfo : GurumddsEventInfo
 {
   rmw_gid_t publisher_gid;
   dds_DataWriter * topic_writer;
   const rosidl_message_type_support_t * rosidl_message_typesupport;
   const char * implementation_identifier;
-  int64_t sequence_number;
+  std::atomic<int64_t> sequence_number{0};
   rmw_context_impl_t * ctx;
+  std::shared_ptr<SerializationPlan> serialization_plan;
+
+  // Retained across publishes, it only grows to the largest serialized sample
+  std::mutex serialization_mutex;
+  std::vector<uint8_t> serialization_buffer;
+  GurumddsLoanPool loan_pool;
+
+  // Subscriptions matched with topic_writer, kept by its publication matched listener
+  GurumddsMatchedStatus matched_subscriptions;
+
+  // A volatile publisher with no matched subscription drops its messages unserialized, since
+  // nobody could ever receive them. Both outcomes are counted for get_publisher_statistics.
+  bool volatile_durability = false;
+  std::atomic<uint64_t> written_count{0};
+  std::atomic<uint64_t> skipped_count{0};
 
   rmw_ret_t get_status(dds_StatusMask mask, void * event) override;
   dds_StatusCondition * get_statuscondition() override;
   dds_StatusMask get_status_changes() override;
+  GurumddsMatchedStatus * get_matched_status() override;
 } GurumddsPublisherInfo;
 
+// Storage behind rmw_publisher_allocation_t. The buffer is sized for the largest message of
+// a bounded type, so publishing with the allocation never grows it.
+typedef struct _GurumddsPublisherAllocation
+{
+  const void * type_support_data;
+  std::vector<uint8_t> serialization_buffer;
+} GurumddsPublisherAllocation;
+
 typedef struct _GurumddsPublisherGID
 {
   uint8_t publication_handle[16];
@@ -91,12 +342,66 @@ typedef struct _GurumddsSubscriberInfo : GurumddsEventInfo
   const rosidl_message_type_support_t * rosidl_message_typesupport;
   const char * implementation_identifier;
   rmw_context_impl_t * ctx;
+  std::shared_ptr<SerializationPlan> serialization_plan;
+  GurumddsTakeSequences take_sequences;
+  GurumddsLoanPool loan_pool;
+
+  // Kept across rmw_take_sequence calls and grown to the largest batch taken. batch_samples is
+  // guarded by the mutex of batch_sequences.
+  GurumddsTakeSequences batch_sequences;
+  std::vector<GurumddsTakenSample> batch_samples;
+
+  // Counts the samples taken so far, starting at 1
+  std::atomic<int64_t> reception_sequence_number{0};
+
+  // Driven by the DataReader's data available listener, which counts the samples that were not
+  // read yet. They are read, not taken, with listener_sequences. The listener only receives
+  // data available while a callback is set.
+  GurumddsEventCallback new_message_callback;
+  GurumddsTakeSequences listener_sequences;
+
+  // Publications matched with topic_reader, kept by its subscription matched listener
+  GurumddsMatchedStatus matched_publications;
+
+  // Samples lent straight out of the DataReader, keyed by the message or the first serialized
+  // message handed to the user. Their sequences hold the DDS loan until it is returned.
+  std::mutex raw_loans_mutex;
+  std::unordered_map<void *, std::unique_ptr<GurumddsTakeSequences>> raw_loans;
+  std::vector<std::unique_ptr<GurumddsTakeSequences>> free_raw_loan_sequences;
+
+  // Publisher GIDs looked up by publication handle, valid for publication_generation. It is
+  // bumped by the subscription matched listener whenever a publication matches or goes away.
+  std::atomic<uint64_t> publication_generation{0};
+  std::mutex publisher_gids_mutex;
+  uint64_t publisher_gids_generation = 0;
+  std::unordered_map<
+    dds_InstanceHandle_t, std::array<uint8_t, RMW_GID_STORAGE_SIZE>> publisher_gids;
 
   rmw_ret_t get_status(dds_StatusMask mask, void * event) override;
   dds_StatusCondition * get_statuscondition() override;
   dds_StatusMask get_status_changes() override;
+  GurumddsMatchedStatus * get_matched_status() override;
 } GurumddsSubscriberInfo;
 
+// Storage behind rmw_subscription_allocation_t, used instead of the subscription's own. It can
+// only be used with subscriptions of the introspection type_support it was initialized for.
+typedef struct _GurumddsSubscriptionAllocation
+{
+  const rosidl_message_type_support_t * type_support = nullptr;
+  GurumddsTakeSequences take_sequences;
+  // Used by rmw_take_sequence, guarded by the mutex of take_sequences
+  std::vector<GurumddsTakenSample> batch_samples;
+} GurumddsSubscriptionAllocation;
+
+// A response routed to a client that shares its endpoints, copied out of the DDS loan
+typedef struct _GurumddsQueuedResponse
+{
+  std::vector<uint8_t> data;
+  int64_t source_timestamp;
+  // Taken from the sample info in the enhanced mapping, the basic mapping carries it in data
+  int64_t sequence_number;
+} GurumddsQueuedResponse;
+
 typedef struct _GurumddsClientInfo
 {
   const rosidl_service_type_support_t * service_typesupport;
@@ -110,10 +415,66 @@ typedef struct _GurumddsClientInfo
   const char * implementation_identifier;
   rmw_context_impl_t * ctx;
 
-  int64_t sequence_number;
+  std::atomic<int64_t> sequence_number{0};
   uint8_t writer_guid[16];
+
+  std::mutex serialization_mutex;
+  std::vector<uint8_t> serialization_buffer;
+  GurumddsTakeSequences take_sequences;
+
+  // Driven by the response reader's data available listener, which only counts the responses
+  // addressed to this client. They are read, not taken, with listener_sequences. The listener
+  // only receives data available while a callback is set, unless the endpoints are shared.
+  GurumddsEventCallback new_response_callback;
+  GurumddsTakeSequences listener_sequences;
+
+  // Current matched counts of request_writer and response_reader, kept by their matched status
+  // listeners. The service is available while both are non-zero.
+  std::atomic<int32_t> matched_subscriptions{0};
+  std::atomic<int32_t> matched_publications{0};
+
+  // Set when the client shares its writer and reader with the other clients of the service.
+  // writer_guid is then the GUID of the shared writer, and the responses to the client's
+  // requests are queued here by the shared reader. response_condition replaces read_condition
+  // and is triggered while any are queued. Routed responses the client was not notified of yet
+  // are counted in pending_notifications, which has to drop to zero before it goes away.
+  _GurumddsSharedClientEndpoints * shared_endpoints = nullptr;
+  std::mutex responses_mutex;
+  std::deque<GurumddsQueuedResponse> responses;
+  dds_GuardCondition * response_condition = nullptr;
+  std::atomic<uint32_t> pending_notifications{0};
 } GurumddsClientInfo;
 
+// Request writer and response reader shared by the clients of a service in a context, when
+// RMW_GURUMDDS_SHARE_CLIENT_ENDPOINTS=1. Every client writes its requests with the GUID of the
+// writer and a sequence number from one counter, and responses are routed to the client that
+// sent the request they carry the sequence number of.
+typedef struct _GurumddsSharedClientEndpoints
+{
+  std::string key;
+  rmw_context_impl_t * ctx = nullptr;
+  dds_DataWriter * request_writer = nullptr;
+  dds_DataReader * response_reader = nullptr;
+  rmw_gid_t publisher_gid;
+  rmw_gid_t subscriber_gid;
+  uint8_t writer_guid[16];
+  std::atomic<int64_t> sequence_number{0};
+  std::atomic<int32_t> matched_subscriptions{0};
+  std::atomic<int32_t> matched_publications{0};
+
+  // Responses queued per client at most, the history depth of the reader or 0 for KEEP_ALL
+  size_t history_depth = 0;
+
+  // Number of clients per node, the endpoints are associated with every node that uses them
+  std::map<const void *, size_t> node_clients;
+
+  // Requests waiting for a response are keyed by sequence number
+  std::mutex clients_mutex;
+  std::set<GurumddsClientInfo *> clients;
+  std::unordered_map<int64_t, GurumddsClientInfo *> pending_requests;
+  GurumddsTakeSequences take_sequences;
+} GurumddsSharedClientEndpoints;
+
 typedef struct _GurumddsServiceInfo
 {
   const rosidl_service_type_support_t * service_typesupport;
@@ -126,6 +487,13 @@ typedef struct _GurumddsServiceInfo
 
   const char * implementation_identifier;
   rmw_context_impl_t * ctx;
+
+  std::mutex serialization_mutex;
+  std::vector<uint8_t> serialization_buffer;
+  GurumddsTakeSequences take_sequences;
+
+  // Driven by the request reader's data available listener
+  GurumddsEventCallback new_request_callback;
 } GurumddsServiceInfo;
 
 #endif  // RMW_GURUMDDS_CPP__TYPES_HPP_
@@ -18,6 +18,7 @@
 #include <cstring>
 #include <string>
 #include <stdexcept>
+#include <vector>
 
 #include "rosidl_runtime_c/string.h"
 #include "rosidl_runtime_c/string_functions.h"
@@ -35,6 +36,9 @@
 
 #define CDR_HEADER_SIZE 4
 #define CDR_HEADER_ENDIAN_IDX 1
+#define CDR_MIN_GROWABLE_SIZE 64
+// Buffers are only sized up front for bounded types up to this size, larger ones grow on demand
+#define CDR_MAX_PRESIZE (64 * 1024)
 
 class CDRBuffer
 {
@@ -53,8 +57,12 @@ protected:
   void align(size_t align_)
   {
     size_t cnt = align_ ? (-offset & (align_ - 1)) : 0;
-    if (buf != nullptr && offset + cnt > size) {
-      throw std::runtime_error("Out of buffer");
+    if (buf != nullptr) {
+      reserve(cnt);
+      if (storage != nullptr) {
+        // growable storage may be reused, so padding has to be cleared explicitly
+        memset(buf + offset, 0, cnt);
+      }
     }
     advance(cnt);
   }
@@ -64,11 +72,37 @@ protected:
     offset += cnt;
   }
 
+  // Makes sure that cnt bytes can be written at the current offset.
+  // Fixed buffers throw when they are exhausted, growable ones are enlarged geometrically.
+  void reserve(size_t cnt)
+  {
+    if (offset + cnt <= size) {
+      return;
+    }
+    if (storage == nullptr) {
+      throw std::runtime_error("Out of buffer");
+    }
+
+    size_t required = CDR_HEADER_SIZE + offset + cnt;
+    size_t capacity = storage->size() * 2;
+    if (capacity < CDR_MIN_GROWABLE_SIZE) {
+      capacity = CDR_MIN_GROWABLE_SIZE;
+    }
+    if (capacity < required) {
+      capacity = required;
+    }
+    storage->resize(capacity);
+    buf = storage->data() + CDR_HEADER_SIZE;
+    size = capacity - CDR_HEADER_SIZE;
+  }
+
   uint8_t * buf;
   size_t offset;
   size_t size;
+  std::vector<uint8_t> * storage;
 
-  CDRBuffer() {}
+  CDRBuffer()
+  : storage(nullptr) {}
 };
 
 class CDRSerializationBuffer : public CDRBuffer
@@ -91,13 +125,26 @@ public:
     offset = 0;
   }
 
+  // Growable mode: the message is serialized in a single pass and a_storage is enlarged
+  // on demand. The serialized size is CDR_HEADER_SIZE + get_offset() when done.
+  explicit CDRSerializationBuffer(std::vector<uint8_t> & a_storage)
+  {
+    storage = &a_storage;
+    if (storage->size() < CDR_MIN_GROWABLE_SIZE) {
+      storage->resize(CDR_MIN_GROWABLE_SIZE);
+    }
+    memset(storage->data(), 0, CDR_HEADER_SIZE);
+    (*storage)[CDR_HEADER_ENDIAN_IDX] = system_endian;
+    buf = storage->data() + CDR_HEADER_SIZE;
+    size = storage->size() - CDR_HEADER_SIZE;
+    offset = 0;
+  }
+
   void operator<<(uint8_t src)
   {
     align(1);
     if (buf != nullptr) {
-      if (offset + 1 > size) {
-        throw std::runtime_error("Out of buffer");
-      }
+      reserve(1);
       *(reinterpret_cast<uint8_t *>(buf + offset)) = src;
     }
     advance(1);
@@ -107,9 +154,7 @@ public:
   {
     align(2);
     if (buf != nullptr) {
-      if (offset + 2 > size) {
-        throw std::runtime_error("Out of buffer");
-      }
+      reserve(2);
       *(reinterpret_cast<uint16_t *>(buf + offset)) = src;
     }
     advance(2);
@@ -119,9 +164,7 @@ public:
   {
     align(4);
     if (buf != nullptr) {
-      if (offset + 4 > size) {
-        throw std::runtime_error("Out of buffer");
-      }
+      reserve(4);
       *(reinterpret_cast<uint32_t *>(buf + offset)) = src;
     }
     advance(4);
@@ -131,9 +174,7 @@ public:
   {
     align(8);
     if (buf != nullptr) {
-      if (offset + 8 > size) {
-        throw std::runtime_error("Out of buffer");
-      }
+      reserve(8);
       *(reinterpret_cast<uint64_t *>(buf + offset)) = src;
     }
     advance(8);
@@ -144,9 +185,7 @@ public:
     *this << static_cast<uint32_t>(src.size() + 1);
     align(1);  // align of char
     if (buf != nullptr) {
-      if (offset + src.size() + 1 > size) {
-        throw std::runtime_error("Out of buffer");
-      }
+      reserve(src.size() + 1);
       memcpy(buf + offset, src.c_str(), src.size() + 1);
     }
     advance(src.size() + 1);
@@ -157,9 +196,7 @@ public:
     *this << static_cast<uint32_t>(src.size());
     align(2);  // align of wchar
     if (buf != nullptr) {
-      if (offset + (src.size() * 2) > size) {
-        throw std::runtime_error("Out of buffer");
-      }
+      reserve(src.size() * 2);
       auto dst = reinterpret_cast<uint16_t *>(buf + offset);
       for (uint32_t i = 0; i < src.size(); i++) {
         *(dst + i) = static_cast<uint16_t>(src[i]);
@@ -173,9 +210,7 @@ public:
     *this << static_cast<uint32_t>(src.size + 1);
     align(1);  // align of char
     if (buf != nullptr) {
-      if (offset + src.size + 1 > size) {
-        throw std::runtime_error("Out of buffer");
-      }
+      reserve(src.size + 1);
       memcpy(buf + offset, src.data, src.size + 1);
     }
     advance(src.size + 1);
@@ -186,9 +221,7 @@ public:
     *this << static_cast<uint32_t>(src.size);
     align(2);  // align of wchar
     if (buf != nullptr) {
-      if (offset + src.size * 2 > size) {
-        throw std::runtime_error("Out of buffer");
-      }
+      reserve(src.size * 2);
       auto dst = reinterpret_cast<uint16_t *>(buf + offset);
       for (uint32_t i = 0; i < src.size; i++) {
         *(dst + i) = static_cast<uint16_t>(src.data[i]);
@@ -205,9 +238,7 @@ public:
 
     align(1);
     if (buf != nullptr) {
-      if (offset + cnt > size) {
-        throw std::runtime_error("Out of buffer");
-      }
+      reserve(cnt);
       memcpy(buf + offset, arr, cnt);
     }
     advance(cnt);
@@ -221,9 +252,7 @@ public:
 
     align(2);
     if (buf != nullptr) {
-      if (offset + cnt * 2 > size) {
-        throw std::runtime_error("Out of buffer");
-      }
+      reserve(cnt * 2);
       memcpy(buf + offset, arr, cnt * 2);
     }
     advance(cnt * 2);
@@ -237,9 +266,7 @@ public:
 
     align(4);
     if (buf != nullptr) {
-      if (offset + cnt * 4 > size) {
-        throw std::runtime_error("Out of buffer");
-      }
+      reserve(cnt * 4);
       memcpy(buf + offset, arr, cnt * 4);
     }
     advance(cnt * 4);
@@ -253,9 +280,7 @@ public:
 
     align(8);
     if (buf != nullptr) {
-      if (offset + cnt * 8 > size) {
-        throw std::runtime_error("Out of buffer");
-      }
+      reserve(cnt * 8);
       memcpy(buf + offset, arr, cnt * 8);
     }
     advance(cnt * 8);
@@ -278,6 +303,11 @@ public:
     offset = 0;
   }
 
+  bool needs_swap() const
+  {
+    return swap;
+  }
+
   void operator>>(uint8_t & dst)
   {
     align(1);
@@ -373,17 +403,23 @@ public:
       if (str_size == 0) {
         dst.data[0] = '\0';
         dst.size = 0;
-        dst.capacity = 1;
         return;
       }
       if (offset + str_size > size) {
         throw std::runtime_error("Out of buffer");
       }
-      rosidl_runtime_c__String__assignn(
-        &dst,
-        reinterpret_cast<const char *>(buf + offset),
-        str_size - 1
-      );
+      if (dst.data != nullptr && dst.capacity >= str_size) {
+        // Reuse the storage left by a previous message
+        memcpy(dst.data, buf + offset, str_size - 1);
+        dst.data[str_size - 1] = '\0';
+        dst.size = str_size - 1;
+      } else if (!rosidl_runtime_c__String__assignn(
+          &dst,
+          reinterpret_cast<const char *>(buf + offset),
+          str_size - 1))
+      {
+        throw std::runtime_error("Failed to assign string");
+      }
     }
     advance(str_size);
   }
@@ -397,14 +433,15 @@ public:
       if (str_size == 0) {
         dst.data[0] = u'\0';
         dst.size = 0;
-        dst.capacity = 1;
         return;
       }
       if (offset + str_size * 2 > size) {
         throw std::runtime_error("Out of buffer");
       }
-      bool res = rosidl_runtime_c__U16String__resize(&dst, str_size + 1);
-      if (!res) {
+      if (dst.data != nullptr && dst.capacity >= str_size + 1) {
+        // Same result as resize() below, without reallocating
+        dst.size = str_size;
+      } else if (!rosidl_runtime_c__U16String__resize(&dst, str_size)) {
         throw std::runtime_error("Failed to resize wstring");
       }
       if (str_size >= 1) {
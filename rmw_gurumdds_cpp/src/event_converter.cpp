@@ -16,17 +16,25 @@
 
 #include "rmw_gurumdds_cpp/event_converter.hpp"
 
-/// mapping of RMW_EVENT to the corresponding dds_StatusKind.
+/// mapping of RMW_EVENT to the corresponding dds_StatusKind, 0 where DDS has no such status.
 static const dds_StatusKind g_mask_map[] {
   dds_LIVELINESS_CHANGED_STATUS,  // RMW_EVENT_LIVELINESS_CHANGED
   dds_REQUESTED_DEADLINE_MISSED_STATUS,  // RMW_EVENT_REQUESTED_DEADLINE_MISSED
   dds_REQUESTED_INCOMPATIBLE_QOS_STATUS,  // RMW_EVENT_REQUESTED_QOS_INCOMPATIBLE
   dds_SAMPLE_LOST_STATUS,  // RMW_EVENT_MESSAGE_LOST
+  0,  // RMW_EVENT_SUBSCRIPTION_INCOMPATIBLE_TYPE
+  dds_SUBSCRIPTION_MATCHED_STATUS,  // RMW_EVENT_SUBSCRIPTION_MATCHED
   dds_LIVELINESS_LOST_STATUS,  // RMW_EVENT_LIVELINESS_LOST
   dds_OFFERED_DEADLINE_MISSED_STATUS,  // RMW_EVENT_OFFERED_DEADLINE_MISSED
-  dds_OFFERED_INCOMPATIBLE_QOS_STATUS  // RMW_EVENT_OFFERED_QOS_INCOMPATIBLE
+  dds_OFFERED_INCOMPATIBLE_QOS_STATUS,  // RMW_EVENT_OFFERED_QOS_INCOMPATIBLE
+  0,  // RMW_EVENT_PUBLISHER_INCOMPATIBLE_TYPE
+  dds_PUBLICATION_MATCHED_STATUS  // RMW_EVENT_PUBLICATION_MATCHED
 };
 
+static_assert(
+  sizeof(g_mask_map) / sizeof(g_mask_map[0]) == RMW_EVENT_INVALID,
+  "g_mask_map must have an entry for every rmw_event_type_t");
+
 dds_StatusKind get_status_kind_from_rmw(const rmw_event_type_t event_t)
 {
   if (!is_event_supported(event_t)) {
@@ -38,7 +46,12 @@ dds_StatusKind get_status_kind_from_rmw(const rmw_event_type_t event_t)
 
 bool is_event_supported(const rmw_event_type_t event_t)
 {
-  return 0 <= event_t && event_t < RMW_EVENT_INVALID;
+  return 0 <= event_t && event_t < RMW_EVENT_INVALID && g_mask_map[static_cast<int>(event_t)] != 0;
+}
+
+bool is_matched_event(const rmw_event_type_t event_t)
+{
+  return event_t == RMW_EVENT_SUBSCRIPTION_MATCHED || event_t == RMW_EVENT_PUBLICATION_MATCHED;
 }
 
 rmw_ret_t check_dds_ret_code(const dds_ReturnCode_t dds_return_code)
@@ -718,7 +718,9 @@ rmw_ret_t
 graph_on_client_created(
   rmw_context_impl_t * const ctx,
   const rmw_node_t * const node,
-  GurumddsClientInfo * const client)
+  GurumddsClientInfo * const client,
+  const bool add_entities,
+  const bool associate)
 {
   std::lock_guard<std::mutex> guard(ctx->common_ctx.node_update_mutex);
   const rmw_gid_t pub_gid = client->publisher_gid;
@@ -737,12 +739,19 @@ graph_on_client_created(
       }
     });
 
-  if (__add_local_subscriber(ctx, node, client->response_reader, sub_gid) != RMW_RET_OK) {
-    return RMW_RET_ERROR;
+  if (add_entities) {
+    if (__add_local_subscriber(ctx, node, client->response_reader, sub_gid) != RMW_RET_OK) {
+      return RMW_RET_ERROR;
+    }
+
+    if (__add_local_publisher(ctx, node, client->request_writer, pub_gid) != RMW_RET_OK) {
+      return RMW_RET_ERROR;
+    }
   }
 
-  if (__add_local_publisher(ctx, node, client->request_writer, pub_gid) != RMW_RET_OK) {
-    return RMW_RET_ERROR;
+  if (!associate) {
+    scope_exit_entities_reset.cancel();
+    return RMW_RET_OK;
   }
 
   ctx->common_ctx.graph_cache.associate_writer(
@@ -782,22 +791,31 @@ rmw_ret_t
 graph_on_client_deleted(
   rmw_context_impl_t * const ctx,
   const rmw_node_t * const node,
-  GurumddsClientInfo * const client)
+  GurumddsClientInfo * const client,
+  const bool remove_entities,
+  const bool dissociate)
 {
   std::lock_guard<std::mutex> guard(ctx->common_ctx.node_update_mutex);
   bool failed = false;
+  rmw_ret_t rc = RMW_RET_OK;
 
-  rmw_ret_t rc = __remove_entity(
-    ctx,
-    client->subscriber_gid,
-    true);
-  failed = failed && (RMW_RET_OK == rc);
+  if (remove_entities) {
+    rc = __remove_entity(
+      ctx,
+      client->subscriber_gid,
+      true);
+    failed = failed && (RMW_RET_OK == rc);
 
-  rc = __remove_entity(
-    ctx,
-    client->publisher_gid,
-    false);
-  failed = failed && (RMW_RET_OK == rc);
+    rc = __remove_entity(
+      ctx,
+      client->publisher_gid,
+      false);
+    failed = failed && (RMW_RET_OK == rc);
+  }
+
+  if (!dissociate) {
+    return failed ? RMW_RET_ERROR : RMW_RET_OK;
+  }
 
   ctx->common_ctx.graph_cache.dissociate_writer(
     client->publisher_gid,
@@ -56,12 +56,14 @@
         auto seq_ptr = \
           (reinterpret_cast<rosidl_runtime_c__uint ## SIZE ## __Sequence *>( \
             output + member->offset_)); \
-        if (seq_ptr->data) { \
-          rosidl_runtime_c__uint ## SIZE ## __Sequence__fini(seq_ptr); \
-        } \
-        bool res = rosidl_runtime_c__uint ## SIZE ## __Sequence__init(seq_ptr, size); \
-        if (!res) { \
-          throw std::runtime_error("Failed to initialize sequence"); \
+        if (!reuse_c_sequence(seq_ptr, size)) { \
+          if (seq_ptr->data) { \
+            rosidl_runtime_c__uint ## SIZE ## __Sequence__fini(seq_ptr); \
+          } \
+          bool res = rosidl_runtime_c__uint ## SIZE ## __Sequence__init(seq_ptr, size); \
+          if (!res) { \
+            throw std::runtime_error("Failed to initialize sequence"); \
+          } \
         } \
  \
         buffer.copy_arr(seq_ptr->data, seq_ptr->size); \
@@ -108,7 +110,7 @@
       if (!member->array_size_ || member->is_upper_bound_) { \
         uint32_t size = 0; \
         buffer >> size; \
-        member->resize_function(output + member->offset_, static_cast<size_t>(size)); \
+        resize_sequence(member, output + member->offset_, static_cast<size_t>(size)); \
       } \
  \
       buffer.copy_arr( \
@@ -463,7 +465,7 @@ void MessageDeserializer::deserialize_wchar(
       // Sequence
       uint32_t size = 0;
       buffer >> size;
-      member->resize_function(output + member->offset_, static_cast<size_t>(size));
+      resize_sequence(member, output + member->offset_, static_cast<size_t>(size));
     }
 
     for (uint32_t i = 0; i < member->size_function(output + member->offset_); i++) {
@@ -489,7 +491,7 @@ void MessageDeserializer::deserialize_string(
       // Sequence
       uint32_t size = 0;
       buffer >> size;
-      member->resize_function(output + member->offset_, size);
+      resize_sequence(member, output + member->offset_, size);
     }
 
     for (uint32_t i = 0; i < member->size_function(output + member->offset_); i++) {
@@ -511,7 +513,7 @@ void MessageDeserializer::deserialize_wstring(
       // Sequence
       uint32_t size = 0;
       buffer >> size;
-      member->resize_function(output + member->offset_, size);
+      resize_sequence(member, output + member->offset_, size);
     }
 
     for (uint32_t i = 0; i < member->size_function(output + member->offset_); i++) {
@@ -533,7 +535,7 @@ void MessageDeserializer::deserialize_struct_arr(
       // Sequence
       uint32_t size = 0;
       buffer >> size;
-      member->resize_function(output + member->offset_, static_cast<size_t>(size));
+      resize_sequence(member, output + member->offset_, static_cast<size_t>(size));
     }
     for (uint32_t j = 0; j < member->size_function(output + member->offset_); j++) {
       deserialize(
@@ -575,12 +577,14 @@ void MessageDeserializer::deserialize_boolean(
       auto seq_ptr =
         (reinterpret_cast<rosidl_runtime_c__boolean__Sequence *>(
           output + member->offset_));
-      if (seq_ptr->data) {
-        rosidl_runtime_c__boolean__Sequence__fini(seq_ptr);
-      }
-      bool res = rosidl_runtime_c__boolean__Sequence__init(seq_ptr, size);
-      if (!res) {
-        throw std::runtime_error("Failed to initialize sequence");
+      if (!reuse_c_sequence(seq_ptr, size)) {
+        if (seq_ptr->data) {
+          rosidl_runtime_c__boolean__Sequence__fini(seq_ptr);
+        }
+        bool res = rosidl_runtime_c__boolean__Sequence__init(seq_ptr, size);
+        if (!res) {
+          throw std::runtime_error("Failed to initialize sequence");
+        }
       }
 
       for (uint32_t i = 0; i < size; i++) {
@@ -617,12 +621,14 @@ void MessageDeserializer::deserialize_wchar(
 
       auto seq_ptr =
         (reinterpret_cast<rosidl_runtime_c__wchar__Sequence *>(output + member->offset_));
-      if (seq_ptr->data) {
-        rosidl_runtime_c__wchar__Sequence__fini(seq_ptr);
-      }
-      bool res = rosidl_runtime_c__wchar__Sequence__init(seq_ptr, size);
-      if (!res) {
-        throw std::runtime_error("Failed to initialize sequence");
+      if (!reuse_c_sequence(seq_ptr, size)) {
+        if (seq_ptr->data) {
+          rosidl_runtime_c__wchar__Sequence__fini(seq_ptr);
+        }
+        bool res = rosidl_runtime_c__wchar__Sequence__init(seq_ptr, size);
+        if (!res) {
+          throw std::runtime_error("Failed to initialize sequence");
+        }
       }
 
       for (uint32_t i = 0; i < size; i++) {
@@ -659,12 +665,14 @@ void MessageDeserializer::deserialize_string(
 
       auto seq_ptr =
         (reinterpret_cast<rosidl_runtime_c__String__Sequence *>(output + member->offset_));
-      if (seq_ptr->data) {
-        rosidl_runtime_c__String__Sequence__fini(seq_ptr);
-      }
-      bool res = rosidl_runtime_c__String__Sequence__init(seq_ptr, size);
-      if (!res) {
-        throw std::runtime_error("Failed to initialize sequence");
+      if (!reuse_c_sequence(seq_ptr, size)) {
+        if (seq_ptr->data) {
+          rosidl_runtime_c__String__Sequence__fini(seq_ptr);
+        }
+        bool res = rosidl_runtime_c__String__Sequence__init(seq_ptr, size);
+        if (!res) {
+          throw std::runtime_error("Failed to initialize sequence");
+        }
       }
 
       for (uint32_t i = 0; i < size; i++) {
@@ -711,12 +719,14 @@ void MessageDeserializer::deserialize_wstring(
       auto seq_ptr =
         (reinterpret_cast<rosidl_runtime_c__U16String__Sequence *>(
           output + member->offset_));
-      if (seq_ptr->data) {
-        rosidl_runtime_c__U16String__Sequence__fini(seq_ptr);
-      }
-      bool res = rosidl_runtime_c__U16String__Sequence__init(seq_ptr, size);
-      if (!res) {
-        throw std::runtime_error("Failed to initialize sequence");
+      if (!reuse_c_sequence(seq_ptr, size)) {
+        if (seq_ptr->data) {
+          rosidl_runtime_c__U16String__Sequence__fini(seq_ptr);
+        }
+        bool res = rosidl_runtime_c__U16String__Sequence__init(seq_ptr, size);
+        if (!res) {
+          throw std::runtime_error("Failed to initialize sequence");
+        }
       }
 
       for (uint32_t i = 0; i < size; i++) {
@@ -759,7 +769,7 @@ void MessageDeserializer::deserialize_struct_arr(
       // Sequence
       uint32_t size = 0;
       buffer >> size;
-      member->resize_function(output + member->offset_, static_cast<size_t>(size));
+      resize_sequence(member, output + member->offset_, static_cast<size_t>(size));
     }
     for (uint32_t j = 0; j < member->size_function(output + member->offset_); j++) {
       deserialize(
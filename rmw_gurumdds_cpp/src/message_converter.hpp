@@ -31,6 +31,48 @@
 
 #include "cdr_buffer.hpp"
 
+// Every rosidl C sequence shares this layout
+struct CSequence
+{
+  void * data;
+  size_t size;
+  size_t capacity;
+};
+
+// Resizes a C sequence in place when its capacity allows it, keeping the elements
+// initialized by a previous take. Returns false when the sequence has to be reallocated.
+inline bool reuse_c_sequence(void * untyped_sequence, size_t size)
+{
+  auto sequence = static_cast<CSequence *>(untyped_sequence);
+  if (sequence->data == nullptr || sequence->capacity < size) {
+    return false;
+  }
+  sequence->size = size;
+  return true;
+}
+
+inline void resize_sequence(
+  const rosidl_typesupport_introspection_c__MessageMember * member,
+  void * sequence,
+  size_t size)
+{
+  if (!reuse_c_sequence(sequence, size) && !member->resize_function(sequence, size)) {
+    throw std::runtime_error("Failed to resize sequence");
+  }
+}
+
+inline void resize_sequence(
+  const rosidl_typesupport_introspection_cpp::MessageMember * member,
+  void * sequence,
+  size_t size)
+{
+  // The C++ resize function cannot report failure, so check its result instead
+  member->resize_function(sequence, size);
+  if (member->size_function(sequence) != size) {
+    throw std::runtime_error("Failed to resize sequence");
+  }
+}
+
 class MessageSerializer
 {
 public:
@@ -41,48 +83,7 @@ public:
   void serialize(const MessageMembersT * members, const uint8_t * input, bool roundup_)
   {
     for (uint32_t i = 0; i < members->member_count_; i++) {
-      auto member = members->members_ + i;
-      switch (member->type_id_) {
-        case rosidl_typesupport_introspection_cpp::ROS_TYPE_BOOLEAN:
-          serialize_boolean(member, input);
-          break;
-        case rosidl_typesupport_introspection_cpp::ROS_TYPE_CHAR:
-        case rosidl_typesupport_introspection_cpp::ROS_TYPE_OCTET:
-        case rosidl_typesupport_introspection_cpp::ROS_TYPE_UINT8:
-        case rosidl_typesupport_introspection_cpp::ROS_TYPE_INT8:
-          serialize_primitive<uint8_t>(member, input);
-          break;
-        case rosidl_typesupport_introspection_cpp::ROS_TYPE_UINT16:
-        case rosidl_typesupport_introspection_cpp::ROS_TYPE_INT16:
-          serialize_primitive<uint16_t>(member, input);
-          break;
-        case rosidl_typesupport_introspection_cpp::ROS_TYPE_FLOAT:
-        case rosidl_typesupport_introspection_cpp::ROS_TYPE_UINT32:
-        case rosidl_typesupport_introspection_cpp::ROS_TYPE_INT32:
-          serialize_primitive<uint32_t>(member, input);
-          break;
-        case rosidl_typesupport_introspection_cpp::ROS_TYPE_DOUBLE:
-        case rosidl_typesupport_introspection_cpp::ROS_TYPE_LONG_DOUBLE:
-        case rosidl_typesupport_introspection_cpp::ROS_TYPE_UINT64:
-        case rosidl_typesupport_introspection_cpp::ROS_TYPE_INT64:
-          serialize_primitive<uint64_t>(member, input);
-          break;
-        case rosidl_typesupport_introspection_cpp::ROS_TYPE_WCHAR:
-          serialize_wchar(member, input);
-          break;
-        case rosidl_typesupport_introspection_cpp::ROS_TYPE_STRING:
-          serialize_string(member, input);
-          break;
-        case rosidl_typesupport_introspection_cpp::ROS_TYPE_WSTRING:
-          serialize_wstring(member, input);
-          break;
-        case rosidl_typesupport_introspection_cpp::ROS_TYPE_MESSAGE:
-          serialize_struct_arr(member, input);
-          break;
-        default:
-          throw std::logic_error("This should not be rechable");
-          break;
-      }
+      serialize_member(members->members_ + i, input);
     }
 
     if (roundup_) {
@@ -90,6 +91,52 @@ public:
     }
   }
 
+  template<typename MessageMemberT>
+  void serialize_member(const MessageMemberT * member, const uint8_t * input)
+  {
+    switch (member->type_id_) {
+      case rosidl_typesupport_introspection_cpp::ROS_TYPE_BOOLEAN:
+        serialize_boolean(member, input);
+        break;
+      case rosidl_typesupport_introspection_cpp::ROS_TYPE_CHAR:
+      case rosidl_typesupport_introspection_cpp::ROS_TYPE_OCTET:
+      case rosidl_typesupport_introspection_cpp::ROS_TYPE_UINT8:
+      case rosidl_typesupport_introspection_cpp::ROS_TYPE_INT8:
+        serialize_primitive<uint8_t>(member, input);
+        break;
+      case rosidl_typesupport_introspection_cpp::ROS_TYPE_UINT16:
+      case rosidl_typesupport_introspection_cpp::ROS_TYPE_INT16:
+        serialize_primitive<uint16_t>(member, input);
+        break;
+      case rosidl_typesupport_introspection_cpp::ROS_TYPE_FLOAT:
+      case rosidl_typesupport_introspection_cpp::ROS_TYPE_UINT32:
+      case rosidl_typesupport_introspection_cpp::ROS_TYPE_INT32:
+        serialize_primitive<uint32_t>(member, input);
+        break;
+      case rosidl_typesupport_introspection_cpp::ROS_TYPE_DOUBLE:
+      case rosidl_typesupport_introspection_cpp::ROS_TYPE_LONG_DOUBLE:
+      case rosidl_typesupport_introspection_cpp::ROS_TYPE_UINT64:
+      case rosidl_typesupport_introspection_cpp::ROS_TYPE_INT64:
+        serialize_primitive<uint64_t>(member, input);
+        break;
+      case rosidl_typesupport_introspection_cpp::ROS_TYPE_WCHAR:
+        serialize_wchar(member, input);
+        break;
+      case rosidl_typesupport_introspection_cpp::ROS_TYPE_STRING:
+        serialize_string(member, input);
+        break;
+      case rosidl_typesupport_introspection_cpp::ROS_TYPE_WSTRING:
+        serialize_wstring(member, input);
+        break;
+      case rosidl_typesupport_introspection_cpp::ROS_TYPE_MESSAGE:
+        serialize_struct_arr(member, input);
+        break;
+      default:
+        throw std::logic_error("This should not be rechable");
+        break;
+    }
+  }
+
 private:
   template<typename MessageMemberT>
   void serialize_boolean(
@@ -135,47 +182,52 @@ public:
   void deserialize(const MessageMembersT * members, uint8_t * output)
   {
     for (uint32_t i = 0; i < members->member_count_; i++) {
-      auto member = members->members_ + i;
-      switch (member->type_id_) {
-        case rosidl_typesupport_introspection_cpp::ROS_TYPE_BOOLEAN:
-          deserialize_boolean(member, output);
-          break;
-        case rosidl_typesupport_introspection_cpp::ROS_TYPE_CHAR:
-        case rosidl_typesupport_introspection_cpp::ROS_TYPE_OCTET:
-        case rosidl_typesupport_introspection_cpp::ROS_TYPE_UINT8:
-        case rosidl_typesupport_introspection_cpp::ROS_TYPE_INT8:
-          deserialize_primitive<uint8_t>(member, output);
-          break;
-        case rosidl_typesupport_introspection_cpp::ROS_TYPE_UINT16:
-        case rosidl_typesupport_introspection_cpp::ROS_TYPE_INT16:
-          deserialize_primitive<uint16_t>(member, output);
-          break;
-        case rosidl_typesupport_introspection_cpp::ROS_TYPE_FLOAT:
-        case rosidl_typesupport_introspection_cpp::ROS_TYPE_UINT32:
-        case rosidl_typesupport_introspection_cpp::ROS_TYPE_INT32:
-          deserialize_primitive<uint32_t>(member, output);
-          break;
-        case rosidl_typesupport_introspection_cpp::ROS_TYPE_DOUBLE:
-        case rosidl_typesupport_introspection_cpp::ROS_TYPE_LONG_DOUBLE:
-        case rosidl_typesupport_introspection_cpp::ROS_TYPE_UINT64:
-        case rosidl_typesupport_introspection_cpp::ROS_TYPE_INT64:
-          deserialize_primitive<uint64_t>(member, output);
-          break;
-        case rosidl_typesupport_introspection_cpp::ROS_TYPE_WCHAR:
-          deserialize_wchar(member, output);
-          break;
-        case rosidl_typesupport_introspection_cpp::ROS_TYPE_STRING:
-          deserialize_string(member, output);
-          break;
-        case rosidl_typesupport_introspection_cpp::ROS_TYPE_WSTRING:
-          deserialize_wstring(member, output);
-          break;
-        case rosidl_typesupport_introspection_cpp::ROS_TYPE_MESSAGE:
-          deserialize_struct_arr(member, output);
-          break;
-        default:
-          break;
-      }
+      deserialize_member(members->members_ + i, output);
+    }
+  }
+
+  template<typename MessageMemberT>
+  void deserialize_member(const MessageMemberT * member, uint8_t * output)
+  {
+    switch (member->type_id_) {
+      case rosidl_typesupport_introspection_cpp::ROS_TYPE_BOOLEAN:
+        deserialize_boolean(member, output);
+        break;
+      case rosidl_typesupport_introspection_cpp::ROS_TYPE_CHAR:
+      case rosidl_typesupport_introspection_cpp::ROS_TYPE_OCTET:
+      case rosidl_typesupport_introspection_cpp::ROS_TYPE_UINT8:
+      case rosidl_typesupport_introspection_cpp::ROS_TYPE_INT8:
+        deserialize_primitive<uint8_t>(member, output);
+        break;
+      case rosidl_typesupport_introspection_cpp::ROS_TYPE_UINT16:
+      case rosidl_typesupport_introspection_cpp::ROS_TYPE_INT16:
+        deserialize_primitive<uint16_t>(member, output);
+        break;
+      case rosidl_typesupport_introspection_cpp::ROS_TYPE_FLOAT:
+      case rosidl_typesupport_introspection_cpp::ROS_TYPE_UINT32:
+      case rosidl_typesupport_introspection_cpp::ROS_TYPE_INT32:
+        deserialize_primitive<uint32_t>(member, output);
+        break;
+      case rosidl_typesupport_introspection_cpp::ROS_TYPE_DOUBLE:
+      case rosidl_typesupport_introspection_cpp::ROS_TYPE_LONG_DOUBLE:
+      case rosidl_typesupport_introspection_cpp::ROS_TYPE_UINT64:
+      case rosidl_typesupport_introspection_cpp::ROS_TYPE_INT64:
+        deserialize_primitive<uint64_t>(member, output);
+        break;
+      case rosidl_typesupport_introspection_cpp::ROS_TYPE_WCHAR:
+        deserialize_wchar(member, output);
+        break;
+      case rosidl_typesupport_introspection_cpp::ROS_TYPE_STRING:
+        deserialize_string(member, output);
+        break;
+      case rosidl_typesupport_introspection_cpp::ROS_TYPE_WSTRING:
+        deserialize_wstring(member, output);
+        break;
+      case rosidl_typesupport_introspection_cpp::ROS_TYPE_MESSAGE:
+        deserialize_struct_arr(member, output);
+        break;
+      default:
+        break;
     }
   }
 
@@ -12,12 +12,16 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <algorithm>
+#include <atomic>
 #include <chrono>
 #include <limits>
 #include <random>
+#include <sstream>
 #include <string>
 #include <thread>
 #include <utility>
+#include <vector>
 
 #include "rcutils/logging_macros.h"
 #include "rcutils/error_handling.h"
@@ -40,6 +44,504 @@
 
 #include "type_support_service.hpp"
 
+// Counts the responses that arrived since the last call and are addressed to this client. They
+// are only read, so they stay in the reader for rmw_take_response.
+static size_t
+_count_new_responses(GurumddsClientInfo * client_info)
+{
+  TakeSequencesGuard sequences(client_info->listener_sequences);
+  if (!sequences.is_valid()) {
+    return 0;
+  }
+
+  size_t count = 0;
+  while (true) {
+    dds_ReturnCode_t ret = dds_DataReader_raw_read_w_sampleinfoex(
+      client_info->response_reader, dds_HANDLE_NIL, sequences.data_values,
+      sequences.sample_infos, sequences.sample_sizes, sequences.length,
+      dds_NOT_READ_SAMPLE_STATE, dds_ANY_VIEW_STATE, dds_ANY_INSTANCE_STATE);
+    uint32_t sample_count = 0;
+    if (ret == dds_RETCODE_OK) {
+      sample_count = dds_SampleInfoSeq_length(sequences.sample_infos);
+    }
+
+    for (uint32_t i = 0; i < sample_count; i++) {
+      dds_SampleInfo * sample_info = dds_SampleInfoSeq_get(sequences.sample_infos, i);
+      void * sample = dds_DataSeq_get(sequences.data_values, i);
+      if (!sample_info->valid_data || sample == nullptr) {
+        continue;
+      }
+
+      uint8_t client_guid[16] = {0};
+      bool res = true;
+      if (client_info->ctx->service_mapping_basic) {
+        res = peek_service_basic_guid(
+          sample, dds_UnsignedLongSeq_get(sequences.sample_sizes, i), client_guid);
+      } else {
+        dds_SampleInfoEx * sampleinfo_ex = reinterpret_cast<dds_SampleInfoEx *>(sample_info);
+        dds_guid_to_ros_guid(reinterpret_cast<uint8_t *>(&sampleinfo_ex->src_guid), client_guid);
+      }
+      if (res && memcmp(client_info->writer_guid, client_guid, 16) == 0) {
+        count++;
+      }
+    }
+
+    dds_DataReader_raw_return_loan(
+      client_info->response_reader, sequences.data_values,
+      sequences.sample_infos, sequences.sample_sizes);
+    if (sample_count < sequences.length) {
+      break;
+    }
+  }
+
+  return count;
+}
+
+static void
+_on_response_available(const dds_DataReader * a_reader)
+{
+  dds_DataReader * reader = const_cast<dds_DataReader *>(a_reader);
+  auto client_info = reinterpret_cast<GurumddsClientInfo *>(
+    dds_Entity_get_context(reinterpret_cast<dds_Entity *>(reader), 0));
+  if (client_info == nullptr) {
+    return;
+  }
+
+  size_t count = _count_new_responses(client_info);
+  if (count > 0) {
+    client_info->new_response_callback.notify(count);
+  }
+}
+
+// Stores the matched count of one side of a client. Availability needs both sides matched, so it
+// only changes when the other side is matched too, and waiters of the graph are woken up then.
+static void
+_update_service_match(
+  rmw_context_impl_t * ctx,
+  std::atomic<int32_t> & matched,
+  const std::atomic<int32_t> & other_matched,
+  int32_t current_count)
+{
+  const bool was_matched = matched.exchange(current_count) > 0;
+  if (other_matched.load() > 0 && was_matched != (current_count > 0)) {
+    rmw_guard_condition_t * graph_guard_condition = ctx->common_ctx.graph_guard_condition;
+    if (graph_guard_condition != nullptr &&
+      rmw_trigger_guard_condition(graph_guard_condition) != RMW_RET_OK)
+    {
+      RCUTILS_LOG_ERROR_NAMED(RMW_GURUMDDS_ID, "failed to trigger graph guard condition");
+      rmw_reset_error();
+    }
+  }
+}
+
+// InfoT is GurumddsClientInfo, or GurumddsSharedClientEndpoints for shared endpoints
+template<typename InfoT>
+static void
+_on_request_writer_matched(
+  const dds_DataWriter * a_writer,
+  const dds_PublicationMatchedStatus * status)
+{
+  dds_DataWriter * writer = const_cast<dds_DataWriter *>(a_writer);
+  auto info = reinterpret_cast<InfoT *>(
+    dds_Entity_get_context(reinterpret_cast<dds_Entity *>(writer), 0));
+  if (info == nullptr || status == nullptr) {
+    return;
+  }
+
+  _update_service_match(
+    info->ctx, info->matched_subscriptions, info->matched_publications, status->current_count);
+}
+
+template<typename InfoT>
+static void
+_on_response_reader_matched(
+  const dds_DataReader * a_reader,
+  const dds_SubscriptionMatchedStatus * status)
+{
+  dds_DataReader * reader = const_cast<dds_DataReader *>(a_reader);
+  auto info = reinterpret_cast<InfoT *>(
+    dds_Entity_get_context(reinterpret_cast<dds_Entity *>(reader), 0));
+  if (info == nullptr || status == nullptr) {
+    return;
+  }
+
+  _update_service_match(
+    info->ctx, info->matched_publications, info->matched_subscriptions, status->current_count);
+}
+
+// Installs the listener of response_reader, which gets data available only when asked to
+template<typename InfoT>
+static dds_ReturnCode_t
+_set_response_listener(
+  dds_DataReader * response_reader,
+  void (*on_data_available)(const dds_DataReader *),
+  bool data_available)
+{
+  dds_DataReaderListener response_listener;
+  memset(&response_listener, 0, sizeof(response_listener));
+  response_listener.on_data_available = on_data_available;
+  response_listener.on_subscription_matched = _on_response_reader_matched<InfoT>;
+  dds_StatusMask mask = dds_SUBSCRIPTION_MATCHED_STATUS;
+  if (data_available) {
+    mask |= dds_DATA_AVAILABLE_STATUS;
+  }
+  return dds_DataReader_set_listener(response_reader, &response_listener, mask);
+}
+
+// Installs the listeners of request_writer and response_reader, whose context must already be
+// info, and takes the matches made before the listeners were in place
+template<typename InfoT>
+static bool
+_set_client_listeners(
+  InfoT * info,
+  dds_DataWriter * request_writer,
+  dds_DataReader * response_reader,
+  void (*on_data_available)(const dds_DataReader *),
+  bool data_available)
+{
+  dds_DataWriterListener request_listener;
+  memset(&request_listener, 0, sizeof(request_listener));
+  request_listener.on_publication_matched = _on_request_writer_matched<InfoT>;
+  if (dds_DataWriter_set_listener(
+      request_writer, &request_listener, dds_PUBLICATION_MATCHED_STATUS) != dds_RETCODE_OK)
+  {
+    RMW_SET_ERROR_MSG("failed to set datawriter listener");
+    return false;
+  }
+
+  if (_set_response_listener<InfoT>(
+      response_reader, on_data_available, data_available) != dds_RETCODE_OK)
+  {
+    RMW_SET_ERROR_MSG("failed to set datareader listener");
+    return false;
+  }
+
+  dds_PublicationMatchedStatus publication_status;
+  if (dds_DataWriter_get_publication_matched_status(
+      request_writer, &publication_status) == dds_RETCODE_OK)
+  {
+    _update_service_match(
+      info->ctx, info->matched_subscriptions, info->matched_publications,
+      publication_status.current_count);
+  }
+
+  dds_SubscriptionMatchedStatus subscription_status;
+  if (dds_DataReader_get_subscription_matched_status(
+      response_reader, &subscription_status) == dds_RETCODE_OK)
+  {
+    _update_service_match(
+      info->ctx, info->matched_publications, info->matched_subscriptions,
+      subscription_status.current_count);
+  }
+
+  return true;
+}
+
+// Clients can only share endpoints whose topic, type and QoS would be identical
+static std::string
+_shared_endpoints_key(
+  const std::string & request_topic_name,
+  const std::string & request_type_name,
+  const rmw_qos_profile_t * qos_policies)
+{
+  std::ostringstream key;
+  key << request_topic_name << '|' << request_type_name << '|' <<
+    qos_policies->history << '|' << qos_policies->depth << '|' <<
+    qos_policies->reliability << '|' << qos_policies->durability << '|' <<
+    qos_policies->deadline.sec << '.' << qos_policies->deadline.nsec << '|' <<
+    qos_policies->lifespan.sec << '.' << qos_policies->lifespan.nsec << '|' <<
+    qos_policies->liveliness << '|' << qos_policies->liveliness_lease_duration.sec << '.' <<
+    qos_policies->liveliness_lease_duration.nsec;
+  return key.str();
+}
+
+// Moves the responses out of the shared reader into the queues of the clients that sent the
+// requests, dropping the ones for other writers. The clients lock is held while routing, so that
+// the responses of a client are queued in order, and released before the clients are notified.
+static rmw_ret_t
+_route_shared_responses(GurumddsSharedClientEndpoints * endpoints)
+{
+  // Clients that got responses and how many, each counted in its pending_notifications
+  std::vector<std::pair<GurumddsClientInfo *, size_t>> routed;
+  rmw_ret_t rc = RMW_RET_OK;
+  {
+    std::lock_guard<std::mutex> guard(endpoints->clients_mutex);
+    TakeSequencesGuard sequences(endpoints->take_sequences);
+    if (!sequences.is_valid()) {
+      RMW_SET_ERROR_MSG("failed to create take sequences");
+      return RMW_RET_ERROR;
+    }
+    dds_DataReader * response_reader = endpoints->response_reader;
+    dds_DataSeq * data_values = sequences.data_values;
+    dds_SampleInfoSeq * sample_infos = sequences.sample_infos;
+    dds_UnsignedLongSeq * sample_sizes = sequences.sample_sizes;
+
+    while (true) {
+      dds_ReturnCode_t ret = dds_DataReader_raw_take_w_sampleinfoex(
+        response_reader, dds_HANDLE_NIL, data_values, sample_infos, sample_sizes, 1,
+        dds_ANY_SAMPLE_STATE, dds_ANY_VIEW_STATE, dds_ANY_INSTANCE_STATE);
+
+      if (ret == dds_RETCODE_NO_DATA) {
+        dds_DataReader_raw_return_loan(response_reader, data_values, sample_infos, sample_sizes);
+        break;
+      }
+
+      if (ret != dds_RETCODE_OK) {
+        RMW_SET_ERROR_MSG("failed to take data");
+        dds_DataReader_raw_return_loan(response_reader, data_values, sample_infos, sample_sizes);
+        rc = RMW_RET_ERROR;
+        break;
+      }
+
+      dds_SampleInfo * sample_info = dds_SampleInfoSeq_get(sample_infos, 0);
+      uint8_t * sample = reinterpret_cast<uint8_t *>(dds_DataSeq_get(data_values, 0));
+      if (sample_info->valid_data && sample != nullptr) {
+        uint32_t size = dds_UnsignedLongSeq_get(sample_sizes, 0);
+        int64_t sequence_number = 0;
+        uint8_t client_guid[16] = {0};
+        bool res = true;
+        if (endpoints->ctx->service_mapping_basic) {
+          res = peek_service_basic_header(
+            sample, static_cast<size_t>(size), client_guid, &sequence_number);
+          if (!res) {
+            // Not a response of ours, nothing to report
+            rcutils_reset_error();
+          }
+        } else {
+          dds_SampleInfoEx * sampleinfo_ex = reinterpret_cast<dds_SampleInfoEx *>(sample_info);
+          dds_guid_to_ros_guid(
+            reinterpret_cast<uint8_t *>(&sampleinfo_ex->src_guid), client_guid);
+          dds_sn_to_ros_sn(sampleinfo_ex->seq, &sequence_number);
+        }
+
+        auto it = endpoints->pending_requests.end();
+        if (res && memcmp(client_guid, endpoints->writer_guid, 16) == 0) {
+          it = endpoints->pending_requests.find(sequence_number);
+        }
+        if (it != endpoints->pending_requests.end()) {
+          GurumddsClientInfo * client_info = it->second;
+          endpoints->pending_requests.erase(it);
+          {
+            std::lock_guard<std::mutex> responses_guard(client_info->responses_mutex);
+            client_info->responses.emplace_back();
+            GurumddsQueuedResponse & response = client_info->responses.back();
+            response.data.assign(sample, sample + size);
+            response.source_timestamp =
+              sample_info->source_timestamp.sec * static_cast<int64_t>(1000000000) +
+              sample_info->source_timestamp.nanosec;
+            response.sequence_number = sequence_number;
+            // The oldest response goes, as the reader of a client of its own would drop it
+            if (endpoints->history_depth > 0 &&
+              client_info->responses.size() > endpoints->history_depth)
+            {
+              client_info->responses.pop_front();
+            }
+            dds_GuardCondition_set_trigger_value(client_info->response_condition, true);
+          }
+
+          auto routed_it = std::find_if(
+            routed.begin(), routed.end(),
+            [client_info](const std::pair<GurumddsClientInfo *, size_t> & entry) {
+              return entry.first == client_info;
+            });
+          if (routed_it != routed.end()) {
+            routed_it->second++;
+          } else {
+            client_info->pending_notifications++;
+            routed.emplace_back(client_info, 1);
+          }
+        }
+      }
+
+      dds_DataReader_raw_return_loan(response_reader, data_values, sample_infos, sample_sizes);
+    }
+  }
+
+  for (auto & entry : routed) {
+    entry.first->new_response_callback.notify(entry.second);
+    entry.first->pending_notifications--;
+  }
+
+  return rc;
+}
+
+static void
+_on_shared_response_available(const dds_DataReader * a_reader)
+{
+  dds_DataReader * reader = const_cast<dds_DataReader *>(a_reader);
+  auto endpoints = reinterpret_cast<GurumddsSharedClientEndpoints *>(
+    dds_Entity_get_context(reinterpret_cast<dds_Entity *>(reader), 0));
+  if (endpoints == nullptr) {
+    return;
+  }
+
+  if (_route_shared_responses(endpoints) != RMW_RET_OK) {
+    RCUTILS_LOG_ERROR_NAMED(
+      RMW_GURUMDDS_ID, "failed to route shared responses: %s", rmw_get_error_string().str);
+    rmw_reset_error();
+  }
+}
+
+static rmw_ret_t
+_take_shared_response(
+  GurumddsClientInfo * client_info,
+  rmw_service_info_t * request_header,
+  void * ros_response,
+  bool * taken)
+{
+  // Responses the listener has not got to yet
+  rmw_ret_t rc = _route_shared_responses(client_info->shared_endpoints);
+  if (rc != RMW_RET_OK) {
+    return rc;
+  }
+
+  GurumddsQueuedResponse response;
+  {
+    std::lock_guard<std::mutex> guard(client_info->responses_mutex);
+    if (client_info->responses.empty()) {
+      return RMW_RET_OK;
+    }
+    response = std::move(client_info->responses.front());
+    client_info->responses.pop_front();
+    if (client_info->responses.empty()) {
+      dds_GuardCondition_set_trigger_value(client_info->response_condition, false);
+    }
+  }
+
+  auto type_support = client_info->service_typesupport;
+  int64_t sequence_number = response.sequence_number;
+  bool res = false;
+  if (client_info->ctx->service_mapping_basic) {
+    int32_t sn_high = 0;
+    uint32_t sn_low = 0;
+    uint8_t client_guid[16] = {0};
+    res = deserialize_response_basic(
+      type_support->data,
+      type_support->typesupport_identifier,
+      ros_response,
+      response.data.data(),
+      response.data.size(),
+      &sn_high,
+      &sn_low,
+      client_guid
+    );
+    sequence_number = ((int64_t)sn_high) << 32 | sn_low;
+  } else {
+    res = deserialize_response_enhanced(
+      type_support->data,
+      type_support->typesupport_identifier,
+      ros_response,
+      response.data.data(),
+      response.data.size()
+    );
+  }
+
+  if (!res) {
+    // Error message already set
+    return RMW_RET_ERROR;
+  }
+
+  request_header->source_timestamp = response.source_timestamp;
+  // TODO(clemjh): SampleInfo doesn't contain received_timestamp
+  request_header->received_timestamp = 0;
+  request_header->request_id.sequence_number = sequence_number;
+  memcpy(request_header->request_id.writer_guid, client_info->writer_guid, 16);
+
+  *taken = true;
+  return RMW_RET_OK;
+}
+
+// Deletes the endpoints once their last client is gone. Topics are left to the participant, as
+// they are for clients with their own endpoints.
+static rmw_ret_t
+_delete_shared_endpoints(rmw_context_impl_t * ctx, GurumddsSharedClientEndpoints * endpoints)
+{
+  dds_DataWriter_set_listener(endpoints->request_writer, nullptr, 0);
+  dds_DataReader_set_listener(endpoints->response_reader, nullptr, 0);
+  dds_ReturnCode_t ret =
+    dds_Subscriber_delete_datareader(ctx->subscriber, endpoints->response_reader);
+  if (ret != dds_RETCODE_OK) {
+    RMW_SET_ERROR_MSG("failed to delete datareader");
+    return RMW_RET_ERROR;
+  }
+
+  ret = dds_Publisher_delete_datawriter(ctx->publisher, endpoints->request_writer);
+  if (ret != dds_RETCODE_OK) {
+    RMW_SET_ERROR_MSG("failed to delete datawriter");
+    return RMW_RET_ERROR;
+  }
+
+  ctx->shared_client_endpoints.erase(endpoints->key);
+  delete endpoints;
+  return RMW_RET_OK;
+}
+
+static rmw_ret_t
+_detach_shared_endpoints(
+  rmw_context_impl_t * ctx,
+  const rmw_node_t * node,
+  GurumddsClientInfo * client_info)
+{
+  GurumddsSharedClientEndpoints * endpoints = client_info->shared_endpoints;
+
+  bool last_client = false;
+  {
+    std::lock_guard<std::mutex> guard(endpoints->clients_mutex);
+    endpoints->clients.erase(client_info);
+    last_client = endpoints->clients.empty();
+    for (auto it = endpoints->pending_requests.begin(); it != endpoints->pending_requests.end(); ) {
+      if (it->second == client_info) {
+        it = endpoints->pending_requests.erase(it);
+      } else {
+        ++it;
+      }
+    }
+  }
+
+  // Routing that picked up responses for the client before it was removed may still notify it
+  while (client_info->pending_notifications.load() > 0) {
+    std::this_thread::yield();
+  }
+
+  bool last_node_client = false;
+  auto it = endpoints->node_clients.find(node);
+  if (it != endpoints->node_clients.end() && --it->second == 0) {
+    endpoints->node_clients.erase(it);
+    last_node_client = true;
+  }
+
+  if (client_info->response_condition != nullptr) {
+    wait_sets_forget_condition(
+      reinterpret_cast<dds_Condition *>(client_info->response_condition));
+    dds_GuardCondition_delete(client_info->response_condition);
+    client_info->response_condition = nullptr;
+  }
+
+  if (last_client && _delete_shared_endpoints(ctx, endpoints) != RMW_RET_OK) {
+    return RMW_RET_ERROR;
+  }
+
+  if (graph_on_client_deleted(
+      ctx, node, client_info, last_client, last_node_client) != RMW_RET_OK)
+  {
+    RCUTILS_LOG_ERROR_NAMED(RMW_GURUMDDS_ID, "failed to update graph for client deletion");
+    return RMW_RET_ERROR;
+  }
+
+  return RMW_RET_OK;
+}
+
+// Withdraws a request of a client with shared endpoints that could not be sent
+static void
+_forget_shared_request(GurumddsClientInfo * client_info, int64_t sequence_number)
+{
+  GurumddsSharedClientEndpoints * endpoints = client_info->shared_endpoints;
+  if (endpoints != nullptr) {
+    std::lock_guard<std::mutex> guard(endpoints->clients_mutex);
+    endpoints->pending_requests.erase(sequence_number);
+  }
+}
+
 extern "C"
 {
 rmw_client_t *
@@ -115,6 +617,13 @@ rmw_create_client(
   uint8_t client_guid[16] = {0};
   dds_ReturnCode_t ret;
 
+  GurumddsSharedClientEndpoints * shared_endpoints = nullptr;
+  std::string shared_key;
+  bool endpoints_created = false;
+  bool shared_registered = false;
+  size_t node_client_count = 0;
+  size_t response_history_depth = 0;
+
   std::pair<std::string, std::string> service_type_name;
   std::pair<std::string, std::string> service_metastring;
   std::string request_topic_name;
@@ -156,11 +665,26 @@ rmw_create_client(
     goto fail;
   }
 
+  if (!client_info->take_sequences.init(1) ||
+    !client_info->listener_sequences.init(RMW_GURUMDDS_LISTENER_READ_LENGTH))
+  {
+    RMW_SET_ERROR_MSG("failed to create take sequences");
+    goto fail;
+  }
+
   client_info->implementation_identifier = RMW_GURUMDDS_ID;
   client_info->service_typesupport = type_support;
-  client_info->sequence_number = 0;
   client_info->ctx = ctx;
 
+  if (ctx->share_client_endpoints) {
+    shared_key = _shared_endpoints_key(request_topic_name, request_type_name, qos_policies);
+    auto it = ctx->shared_client_endpoints.find(shared_key);
+    if (it != ctx->shared_client_endpoints.end()) {
+      shared_endpoints = it->second;
+      goto attach_shared_endpoints;
+    }
+  }
+
   request_typesupport = dds_TypeSupport_create(request_metastring.c_str());
   if (request_typesupport == nullptr) {
     RMW_SET_ERROR_MSG("failed to create typesupport");
@@ -286,6 +810,9 @@ rmw_create_client(
     // error message already set
     goto fail;
   }
+  if (datareader_qos.history.kind == dds_KEEP_LAST_HISTORY_QOS) {
+    response_history_depth = static_cast<size_t>(datareader_qos.history.depth);
+  }
 
   response_reader = dds_Subscriber_create_datareader(
     subscriber, response_topic, &datareader_qos, nullptr, 0);
@@ -302,6 +829,48 @@ rmw_create_client(
     goto fail;
   }
 
+  if (ctx->share_client_endpoints) {
+    shared_endpoints = new(std::nothrow) GurumddsSharedClientEndpoints();
+    if (shared_endpoints == nullptr) {
+      RMW_SET_ERROR_MSG("failed to allocate GurumddsSharedClientEndpoints");
+      goto fail;
+    }
+    endpoints_created = true;
+
+    if (!shared_endpoints->take_sequences.init(1)) {
+      RMW_SET_ERROR_MSG("failed to create take sequences");
+      goto fail;
+    }
+
+    shared_endpoints->key = shared_key;
+    shared_endpoints->ctx = ctx;
+    shared_endpoints->history_depth = response_history_depth;
+    shared_endpoints->request_writer = request_writer;
+    shared_endpoints->response_reader = response_reader;
+    entity_get_gid(
+      reinterpret_cast<dds_Entity *>(request_writer), shared_endpoints->publisher_gid);
+    entity_get_gid(
+      reinterpret_cast<dds_Entity *>(response_reader), shared_endpoints->subscriber_gid);
+    dds_DataWriter_get_guid(request_writer, shared_endpoints->writer_guid);
+
+    dds_Entity_set_context(
+      reinterpret_cast<dds_Entity *>(request_writer), 0,
+      reinterpret_cast<void *>(shared_endpoints));
+    dds_Entity_set_context(
+      reinterpret_cast<dds_Entity *>(response_reader), 0,
+      reinterpret_cast<void *>(shared_endpoints));
+    // Responses are always routed, as the wait sets of the clients depend on it
+    if (!_set_client_listeners(
+        shared_endpoints, request_writer, response_reader, _on_shared_response_available, true))
+    {
+      // Error message already set
+      goto fail;
+    }
+
+    ctx->shared_client_endpoints[shared_key] = shared_endpoints;
+    goto attach_shared_endpoints;
+  }
+
   read_condition = dds_DataReader_create_readcondition(
     response_reader, dds_ANY_SAMPLE_STATE, dds_ANY_VIEW_STATE, dds_ANY_INSTANCE_STATE);
   if (read_condition == nullptr) {
@@ -314,6 +883,34 @@ rmw_create_client(
   dds_DataWriter_get_guid(request_writer, client_guid);
   memcpy(client_info->writer_guid, client_guid, sizeof(client_guid));
 
+  dds_Entity_set_context(
+    reinterpret_cast<dds_Entity *>(request_writer), 0, reinterpret_cast<void *>(client_info));
+  dds_Entity_set_context(
+    reinterpret_cast<dds_Entity *>(response_reader), 0, reinterpret_cast<void *>(client_info));
+  if (!_set_client_listeners(
+      client_info, request_writer, response_reader, _on_response_available, false))
+  {
+    // Error message already set
+    goto fail;
+  }
+
+attach_shared_endpoints:
+  if (shared_endpoints != nullptr) {
+    client_info->shared_endpoints = shared_endpoints;
+    client_info->request_writer = shared_endpoints->request_writer;
+    client_info->response_reader = shared_endpoints->response_reader;
+
+    // Requests are written with the GUID of the shared writer, responses are routed back to
+    // the client by sequence number
+    memcpy(client_info->writer_guid, shared_endpoints->writer_guid, 16);
+
+    client_info->response_condition = dds_GuardCondition_create();
+    if (client_info->response_condition == nullptr) {
+      RMW_SET_ERROR_MSG("failed to create guard condition");
+      goto fail;
+    }
+  }
+
   entity_get_gid(
     reinterpret_cast<dds_Entity *>(client_info->request_writer),
     client_info->publisher_gid);
@@ -337,15 +934,34 @@ rmw_create_client(
   }
   memcpy(const_cast<char *>(rmw_client->service_name), service_name, strlen(service_name) + 1);
 
-  if (graph_on_client_created(ctx, node, client_info) != RMW_RET_OK) {
+  if (shared_endpoints != nullptr) {
+    {
+      std::lock_guard<std::mutex> clients_guard(shared_endpoints->clients_mutex);
+      shared_endpoints->clients.insert(client_info);
+    }
+    node_client_count = ++shared_endpoints->node_clients[node];
+    shared_registered = true;
+  }
+
+  // Shared endpoints enter the graph with their first client, and each node that uses them is
+  // associated once
+  if (graph_on_client_created(
+      ctx, node, client_info,
+      shared_endpoints == nullptr || endpoints_created,
+      shared_endpoints == nullptr || node_client_count == 1) != RMW_RET_OK)
+  {
     RCUTILS_LOG_ERROR_NAMED(RMW_GURUMDDS_ID, "failed to update graph for client creation");
     goto fail;
   }
 
-  dds_TypeSupport_delete(request_typesupport);
-  request_typesupport = nullptr;
-  dds_TypeSupport_delete(response_typesupport);
-  response_typesupport = nullptr;
+  if (request_typesupport != nullptr) {
+    dds_TypeSupport_delete(request_typesupport);
+    request_typesupport = nullptr;
+  }
+  if (response_typesupport != nullptr) {
+    dds_TypeSupport_delete(response_typesupport);
+    response_typesupport = nullptr;
+  }
 
   RCUTILS_LOG_DEBUG_NAMED(
     RMW_GURUMDDS_ID,
@@ -363,17 +979,38 @@ fail:
     rmw_client_free(rmw_client);
   }
 
+  if (shared_registered) {
+    {
+      std::lock_guard<std::mutex> clients_guard(shared_endpoints->clients_mutex);
+      shared_endpoints->clients.erase(client_info);
+    }
+    if (--shared_endpoints->node_clients[node] == 0) {
+      shared_endpoints->node_clients.erase(node);
+    }
+  }
+
+  if (client_info != nullptr && client_info->response_condition != nullptr) {
+    dds_GuardCondition_delete(client_info->response_condition);
+  }
+
   if (request_writer != nullptr) {
+    dds_DataWriter_set_listener(request_writer, nullptr, 0);
     dds_Publisher_delete_datawriter(publisher, request_writer);
   }
 
   if (response_reader != nullptr) {
+    dds_DataReader_set_listener(response_reader, nullptr, 0);
     if (read_condition != nullptr) {
       dds_DataReader_delete_readcondition(response_reader, read_condition);
     }
     dds_Subscriber_delete_datareader(subscriber, response_reader);
   }
 
+  if (endpoints_created) {
+    ctx->shared_client_endpoints.erase(shared_key);
+    delete shared_endpoints;
+  }
+
   if (request_topic != nullptr) {
     dds_DomainParticipant_delete_topic(participant, request_topic);
   }
@@ -419,35 +1056,45 @@ rmw_destroy_client(rmw_node_t * node, rmw_client_t * client)
   GurumddsClientInfo * client_info = static_cast<GurumddsClientInfo *>(client->data);
 
   if (client_info != nullptr) {
-    if (client_info->request_writer != nullptr) {
-      ret = dds_Publisher_delete_datawriter(ctx->publisher, client_info->request_writer);
-      if (ret != dds_RETCODE_OK) {
-        RMW_SET_ERROR_MSG("failed to delete datawriter");
+    if (client_info->shared_endpoints != nullptr) {
+      if (_detach_shared_endpoints(ctx, node, client_info) != RMW_RET_OK) {
         return RMW_RET_ERROR;
       }
-    }
+    } else {
+      if (client_info->request_writer != nullptr) {
+        dds_DataWriter_set_listener(client_info->request_writer, nullptr, 0);
+        ret = dds_Publisher_delete_datawriter(ctx->publisher, client_info->request_writer);
+        if (ret != dds_RETCODE_OK) {
+          RMW_SET_ERROR_MSG("failed to delete datawriter");
+          return RMW_RET_ERROR;
+        }
+      }
 
-    if (client_info->response_reader != nullptr) {
-      if (client_info->read_condition != nullptr) {
-        ret = dds_DataReader_delete_readcondition(
-          client_info->response_reader, client_info->read_condition);
+      if (client_info->response_reader != nullptr) {
+        dds_DataReader_set_listener(client_info->response_reader, nullptr, 0);
+        if (client_info->read_condition != nullptr) {
+          wait_sets_forget_condition(
+            reinterpret_cast<dds_Condition *>(client_info->read_condition));
+          ret = dds_DataReader_delete_readcondition(
+            client_info->response_reader, client_info->read_condition);
+          if (ret != dds_RETCODE_OK) {
+            RMW_SET_ERROR_MSG("failed to delete readcondition");
+            return RMW_RET_ERROR;
+          }
+        }
+        ret = dds_Subscriber_delete_datareader(ctx->subscriber, client_info->response_reader);
         if (ret != dds_RETCODE_OK) {
-          RMW_SET_ERROR_MSG("failed to delete readcondition");
+          RMW_SET_ERROR_MSG("failed to delete datareader");
           return RMW_RET_ERROR;
         }
       }
-      ret = dds_Subscriber_delete_datareader(ctx->subscriber, client_info->response_reader);
-      if (ret != dds_RETCODE_OK) {
-        RMW_SET_ERROR_MSG("failed to delete datareader");
+
+      if (graph_on_client_deleted(ctx, node, client_info) != RMW_RET_OK) {
+        RCUTILS_LOG_ERROR_NAMED(RMW_GURUMDDS_ID, "failed to update graph for client deletion");
         return RMW_RET_ERROR;
       }
     }
 
-    if (graph_on_client_deleted(ctx, node, client_info) != RMW_RET_OK) {
-      RCUTILS_LOG_ERROR_NAMED(RMW_GURUMDDS_ID, "failed to update graph for client deletion");
-      return RMW_RET_ERROR;
-    }
-
     delete client_info;
     client->data = nullptr;
   }
@@ -491,64 +1138,16 @@ rmw_service_server_is_available(
     return RMW_RET_ERROR;
   }
 
-  dds_DataWriter * request_writer = client_info->request_writer;
-  if (request_writer == nullptr) {
-    RMW_SET_ERROR_MSG("request writer is null");
-    return RMW_RET_ERROR;
-  }
-
-  dds_DataReader * response_reader = client_info->response_reader;
-  if (response_reader == nullptr) {
-    RMW_SET_ERROR_MSG("response reader is null");
-    return RMW_RET_ERROR;
-  }
-
-  *is_available = false;
-
-  dds_InstanceHandleSeq * seq = dds_InstanceHandleSeq_create(4);
-  if (seq == nullptr) {
-    RMW_SET_ERROR_MSG("failed to create instance handle sequence");
-    return RMW_RET_ERROR;
-  }
-
-  // Look for matching request reader
-  if (dds_DataWriter_get_matched_subscriptions(request_writer, seq) != dds_RETCODE_OK) {
-    RMW_SET_ERROR_MSG("failed to get matched subscriptions");
-    dds_InstanceHandleSeq_delete(seq);
-    return RMW_RET_ERROR;
-  }
-
-  auto sub_cnt = dds_InstanceHandleSeq_length(seq);
-  dds_InstanceHandleSeq_delete(seq);
-
-  // Matching request reader not found
-  if (sub_cnt == 0) {
-    return RMW_RET_OK;
-  }
-
-  seq = dds_InstanceHandleSeq_create(4);
-  if (seq == nullptr) {
-    RMW_SET_ERROR_MSG("failed to create instance handle sequence");
-    return RMW_RET_ERROR;
-  }
-
-  // Look for matching response writer
-  if (dds_DataReader_get_matched_publications(response_reader, seq) != dds_RETCODE_OK) {
-    RMW_SET_ERROR_MSG("failed to get matched publications");
-    dds_InstanceHandleSeq_delete(seq);
-    return RMW_RET_ERROR;
-  }
-
-  auto pub_cnt = dds_InstanceHandleSeq_length(seq);
-  dds_InstanceHandleSeq_delete(seq);
-
-  // Matching response writer not found
-  if (pub_cnt == 0) {
-    return RMW_RET_OK;
+  // Both counts are kept by the matched status listeners, so this is polled without DDS calls
+  GurumddsSharedClientEndpoints * endpoints = client_info->shared_endpoints;
+  if (endpoints != nullptr) {
+    *is_available =
+      endpoints->matched_subscriptions.load() > 0 && endpoints->matched_publications.load() > 0;
+  } else {
+    *is_available =
+      client_info->matched_subscriptions.load() > 0 && client_info->matched_publications.load() > 0;
   }
 
-  *is_available = true;
-
   return RMW_RET_OK;
 }
 
@@ -685,85 +1284,77 @@ rmw_send_request(
   }
 
   size_t size = 0;
+  std::unique_lock<std::mutex> buffer_lock(client_info->serialization_mutex, std::try_to_lock);
+  std::vector<uint8_t> temporary_buffer;
+  std::vector<uint8_t> & dds_request =
+    buffer_lock.owns_lock() ? client_info->serialization_buffer : temporary_buffer;
+
+  // Clients with shared endpoints number their requests with one counter, and the request is
+  // registered before it is written so that its response can be routed back
+  int64_t sequence_number = 0;
+  GurumddsSharedClientEndpoints * endpoints = client_info->shared_endpoints;
+  if (endpoints != nullptr) {
+    sequence_number = endpoints->sequence_number.fetch_add(1) + 1;
+    std::lock_guard<std::mutex> guard(endpoints->clients_mutex);
+    endpoints->pending_requests[sequence_number] = client_info;
+  } else {
+    sequence_number = client_info->sequence_number.fetch_add(1) + 1;
+  }
 
   if (client_info->ctx->service_mapping_basic) {
-    void * dds_request = allocate_request_basic(
-      type_support->data,
-      type_support->typesupport_identifier,
-      ros_request,
-      &size
-    );
-
-    if (dds_request == nullptr) {
-      return RMW_RET_ERROR;
-    }
-
     bool res = serialize_request_basic(
       type_support->data,
       type_support->typesupport_identifier,
       ros_request,
       dds_request,
-      size,
-      ++client_info->sequence_number,
+      &size,
+      sequence_number,
       client_info->writer_guid
     );
 
     if (!res) {
       RMW_SET_ERROR_MSG("failed to serialize message");
-      free(dds_request);
+      _forget_shared_request(client_info, sequence_number);
       return RMW_RET_ERROR;
     }
 
-    if (dds_DataWriter_raw_write(request_writer, dds_request, size) != dds_RETCODE_OK) {
+    if (dds_DataWriter_raw_write(request_writer, dds_request.data(), size) != dds_RETCODE_OK) {
       RMW_SET_ERROR_MSG("failed to send request");
-      free(dds_request);
+      _forget_shared_request(client_info, sequence_number);
       return RMW_RET_ERROR;
     }
-    free(dds_request);
   } else {
-    void * dds_request = allocate_request_enhanced(
-      type_support->data,
-      type_support->typesupport_identifier,
-      ros_request,
-      &size
-    );
-
-    if (dds_request == nullptr) {
-      return RMW_RET_ERROR;
-    }
-
     bool res = serialize_request_enhanced(
       type_support->data,
       type_support->typesupport_identifier,
       ros_request,
       dds_request,
-      size
+      &size
     );
 
     if (!res) {
       RMW_SET_ERROR_MSG("failed to serialize message");
-      free(dds_request);
+      _forget_shared_request(client_info, sequence_number);
       return RMW_RET_ERROR;
     }
 
     dds_SampleInfoEx sampleinfo_ex;
     memset(&sampleinfo_ex, 0, sizeof(dds_SampleInfoEx));
-    ros_sn_to_dds_sn(++client_info->sequence_number, &sampleinfo_ex.seq);
+    ros_sn_to_dds_sn(sequence_number, &sampleinfo_ex.seq);
     ros_guid_to_dds_guid(
       client_info->writer_guid,
       reinterpret_cast<uint8_t *>(&sampleinfo_ex.src_guid));
 
     if (dds_DataWriter_raw_write_w_sampleinfoex(
-        request_writer, dds_request, size, &sampleinfo_ex) != dds_RETCODE_OK)
+        request_writer, dds_request.data(), size, &sampleinfo_ex) != dds_RETCODE_OK)
     {
       RMW_SET_ERROR_MSG("failed to send request");
-      free(dds_request);
+      _forget_shared_request(client_info, sequence_number);
       return RMW_RET_ERROR;
     }
-    free(dds_request);
   }
 
-  *sequence_id = client_info->sequence_number;
+  *sequence_id = sequence_number;
 
   return RMW_RET_OK;
 }
@@ -804,26 +1395,18 @@ rmw_take_response(
     return RMW_RET_ERROR;
   }
 
-  dds_DataSeq * data_values = dds_DataSeq_create(1);
-  if (data_values == nullptr) {
-    RMW_SET_ERROR_MSG("failed to create data sequence");
-    return RMW_RET_ERROR;
-  }
-
-  dds_SampleInfoSeq * sample_infos = dds_SampleInfoSeq_create(1);
-  if (sample_infos == nullptr) {
-    RMW_SET_ERROR_MSG("failed to create sample info sequence");
-    dds_DataSeq_delete(data_values);
-    return RMW_RET_ERROR;
+  if (client_info->shared_endpoints != nullptr) {
+    return _take_shared_response(client_info, request_header, ros_response, taken);
   }
 
-  dds_UnsignedLongSeq * sample_sizes = dds_UnsignedLongSeq_create(1);
-  if (sample_sizes == nullptr) {
-    RMW_SET_ERROR_MSG("failed to create sample size sequence");
-    dds_DataSeq_delete(data_values);
-    dds_SampleInfoSeq_delete(sample_infos);
+  TakeSequencesGuard sequences(client_info->take_sequences);
+  if (!sequences.is_valid()) {
+    RMW_SET_ERROR_MSG("failed to create take sequences");
     return RMW_RET_ERROR;
   }
+  dds_DataSeq * data_values = sequences.data_values;
+  dds_SampleInfoSeq * sample_infos = sequences.sample_infos;
+  dds_UnsignedLongSeq * sample_sizes = sequences.sample_sizes;
 
   dds_ReturnCode_t ret = dds_RETCODE_OK;
 
@@ -835,18 +1418,12 @@ rmw_take_response(
 
       if (ret == dds_RETCODE_NO_DATA) {
         dds_DataReader_raw_return_loan(response_reader, data_values, sample_infos, sample_sizes);
-        dds_DataSeq_delete(data_values);
-        dds_SampleInfoSeq_delete(sample_infos);
-        dds_UnsignedLongSeq_delete(sample_sizes);
         return RMW_RET_OK;
       }
 
       if (ret != dds_RETCODE_OK) {
         RMW_SET_ERROR_MSG("failed to take data");
         dds_DataReader_raw_return_loan(response_reader, data_values, sample_infos, sample_sizes);
-        dds_DataSeq_delete(data_values);
-        dds_SampleInfoSeq_delete(sample_infos);
-        dds_UnsignedLongSeq_delete(sample_sizes);
         return RMW_RET_ERROR;
       }
 
@@ -855,36 +1432,41 @@ rmw_take_response(
         void * sample = dds_DataSeq_get(data_values, 0);
         if (sample == nullptr) {
           dds_DataReader_raw_return_loan(response_reader, data_values, sample_infos, sample_sizes);
-          dds_DataSeq_delete(data_values);
-          dds_SampleInfoSeq_delete(sample_infos);
-          dds_UnsignedLongSeq_delete(sample_sizes);
           return RMW_RET_ERROR;
         }
         uint32_t size = dds_UnsignedLongSeq_get(sample_sizes, 0);
         int32_t sn_high = 0;
         uint32_t sn_low = 0;
         uint8_t client_guid[16] = {0};
-        bool res = deserialize_response_basic(
-          type_support->data,
-          type_support->typesupport_identifier,
-          ros_response,
-          sample,
-          static_cast<size_t>(size),
-          &sn_high,
-          &sn_low,
-          client_guid
-        );
 
+        // Every client of the service receives every response, so the ones addressed to other
+        // clients are dropped before they are deserialized
+        bool res = peek_service_basic_guid(sample, static_cast<size_t>(size), client_guid);
         if (!res) {
           // Error message already set
           dds_DataReader_raw_return_loan(response_reader, data_values, sample_infos, sample_sizes);
-          dds_DataSeq_delete(data_values);
-          dds_SampleInfoSeq_delete(sample_infos);
-          dds_UnsignedLongSeq_delete(sample_sizes);
           return RMW_RET_ERROR;
         }
 
         if (memcmp(client_info->writer_guid, client_guid, 16) == 0) {
+          res = deserialize_response_basic(
+            type_support->data,
+            type_support->typesupport_identifier,
+            ros_response,
+            sample,
+            static_cast<size_t>(size),
+            &sn_high,
+            &sn_low,
+            client_guid
+          );
+
+          if (!res) {
+            // Error message already set
+            dds_DataReader_raw_return_loan(
+              response_reader, data_values, sample_infos, sample_sizes);
+            return RMW_RET_ERROR;
+          }
+
           request_header->source_timestamp =
             sample_info->source_timestamp.sec * static_cast<int64_t>(1000000000) +
             sample_info->source_timestamp.nanosec;
@@ -909,18 +1491,12 @@ rmw_take_response(
 
       if (ret == dds_RETCODE_NO_DATA) {
         dds_DataReader_raw_return_loan(response_reader, data_values, sample_infos, sample_sizes);
-        dds_DataSeq_delete(data_values);
-        dds_SampleInfoSeq_delete(sample_infos);
-        dds_UnsignedLongSeq_delete(sample_sizes);
         return RMW_RET_OK;
       }
 
       if (ret != dds_RETCODE_OK) {
         RMW_SET_ERROR_MSG("failed to take data");
         dds_DataReader_raw_return_loan(response_reader, data_values, sample_infos, sample_sizes);
-        dds_DataSeq_delete(data_values);
-        dds_SampleInfoSeq_delete(sample_infos);
-        dds_UnsignedLongSeq_delete(sample_sizes);
         return RMW_RET_ERROR;
       }
 
@@ -929,9 +1505,6 @@ rmw_take_response(
         void * sample = dds_DataSeq_get(data_values, 0);
         if (sample == nullptr) {
           dds_DataReader_raw_return_loan(response_reader, data_values, sample_infos, sample_sizes);
-          dds_DataSeq_delete(data_values);
-          dds_SampleInfoSeq_delete(sample_infos);
-          dds_UnsignedLongSeq_delete(sample_sizes);
           return RMW_RET_ERROR;
         }
         uint32_t size = dds_UnsignedLongSeq_get(sample_sizes, 0);
@@ -941,24 +1514,22 @@ rmw_take_response(
         dds_guid_to_ros_guid(reinterpret_cast<uint8_t *>(&sampleinfo_ex->src_guid), client_guid);
         dds_sn_to_ros_sn(sampleinfo_ex->seq, &sequence_number);
 
-        bool res = deserialize_response_enhanced(
-          type_support->data,
-          type_support->typesupport_identifier,
-          ros_response,
-          sample,
-          static_cast<size_t>(size)
-        );
-
-        if (!res) {
-          // Error message already set
-          dds_DataReader_raw_return_loan(response_reader, data_values, sample_infos, sample_sizes);
-          dds_DataSeq_delete(data_values);
-          dds_SampleInfoSeq_delete(sample_infos);
-          dds_UnsignedLongSeq_delete(sample_sizes);
-          return RMW_RET_ERROR;
-        }
-
         if (memcmp(client_info->writer_guid, client_guid, 16) == 0) {
+          bool res = deserialize_response_enhanced(
+            type_support->data,
+            type_support->typesupport_identifier,
+            ros_response,
+            sample,
+            static_cast<size_t>(size)
+          );
+
+          if (!res) {
+            // Error message already set
+            dds_DataReader_raw_return_loan(
+              response_reader, data_values, sample_infos, sample_sizes);
+            return RMW_RET_ERROR;
+          }
+
           request_header->source_timestamp =
             sample_info->source_timestamp.sec * static_cast<int64_t>(1000000000) +
             sample_info->source_timestamp.nanosec;
@@ -977,10 +1548,6 @@ rmw_take_response(
     }
   }
 
-  dds_DataSeq_delete(data_values);
-  dds_SampleInfoSeq_delete(sample_infos);
-  dds_UnsignedLongSeq_delete(sample_sizes);
-
   return RMW_RET_OK;
 }
 
@@ -990,12 +1557,50 @@ rmw_client_set_on_new_response_callback(
   rmw_event_callback_t callback,
   const void * user_data)
 {
-  (void)rmw_client;
-  (void)callback;
-  (void)user_data;
+  RMW_CHECK_ARGUMENT_FOR_NULL(rmw_client, RMW_RET_INVALID_ARGUMENT);
+  RMW_CHECK_TYPE_IDENTIFIERS_MATCH(
+    rmw_client,
+    rmw_client->implementation_identifier, RMW_GURUMDDS_ID,
+    return RMW_RET_INCORRECT_RMW_IMPLEMENTATION);
 
-  RMW_SET_ERROR_MSG("rmw_client_set_on_new_request_callback not implemented");
-  return RMW_RET_UNSUPPORTED;
+  GurumddsClientInfo * client_info = static_cast<GurumddsClientInfo *>(rmw_client->data);
+  if (client_info == nullptr) {
+    RMW_SET_ERROR_MSG("client info handle is null");
+    return RMW_RET_ERROR;
+  }
+
+  // Shared endpoints notify their clients as they route responses
+  if (client_info->shared_endpoints != nullptr) {
+    client_info->new_response_callback.set(callback, user_data);
+    return RMW_RET_OK;
+  }
+
+  if (callback == nullptr) {
+    if (_set_response_listener<GurumddsClientInfo>(
+        client_info->response_reader, _on_response_available, false) != dds_RETCODE_OK)
+    {
+      RMW_SET_ERROR_MSG("failed to set datareader listener");
+      return RMW_RET_ERROR;
+    }
+    client_info->new_response_callback.set(nullptr, nullptr);
+    return RMW_RET_OK;
+  }
+
+  client_info->new_response_callback.set(callback, user_data);
+  if (_set_response_listener<GurumddsClientInfo>(
+      client_info->response_reader, _on_response_available, true) != dds_RETCODE_OK)
+  {
+    client_info->new_response_callback.set(nullptr, nullptr);
+    RMW_SET_ERROR_MSG("failed to set datareader listener");
+    return RMW_RET_ERROR;
+  }
+
+  // Responses that arrived while no callback was set are still unread in the reader
+  size_t count = _count_new_responses(client_info);
+  if (count > 0) {
+    client_info->new_response_callback.notify(count);
+  }
+  return RMW_RET_OK;
 }
 
 rmw_ret_t
@@ -343,6 +343,8 @@ rmw_context_impl_t::finalize()
 {
   dds_DomainParticipantFactory * factory = dds_DomainParticipantFactory_get_instance();
 
+  this->take_sequence_pool.shutdown();
+
   if (this->participant != nullptr) {
     if (dds_RETCODE_OK !=
       dds_DomainParticipantFactory_delete_participant(factory, this->participant))
@@ -39,6 +39,11 @@ init_rmw_event(
     identifier,
     return RMW_RET_INCORRECT_RMW_IMPLEMENTATION);
 
+  if (!is_event_supported(event_type)) {
+    RMW_SET_ERROR_MSG_WITH_FORMAT_STRING("event %d not supported", event_type);
+    return RMW_RET_UNSUPPORTED;
+  }
+
   rmw_event->implementation_identifier = topic_endpoint_impl_identifier;
   rmw_event->data = data;
   rmw_event->event_type = event_type;
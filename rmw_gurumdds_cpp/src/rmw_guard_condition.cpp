@@ -19,6 +19,7 @@
 
 #include "rmw_gurumdds_cpp/dds_include.hpp"
 #include "rmw_gurumdds_cpp/identifier.hpp"
+#include "rmw_gurumdds_cpp/types.hpp"
 
 extern "C"
 {
@@ -72,6 +73,7 @@ rmw_destroy_guard_condition(rmw_guard_condition_t * guard_condition)
 
   dds_GuardCondition * dds_guard_condition =
     static_cast<dds_GuardCondition *>(guard_condition->data);
+  wait_sets_forget_condition(reinterpret_cast<dds_Condition *>(dds_guard_condition));
   dds_GuardCondition_delete(dds_guard_condition);
   rmw_guard_condition_free(guard_condition);
 
@@ -12,6 +12,10 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+
 #include "rcutils/logging_macros.h"
 #include "rcutils/strdup.h"
 
@@ -24,6 +28,32 @@
 #include "rmw_gurumdds_cpp/identifier.hpp"
 #include "rmw_gurumdds_cpp/rmw_context_impl.hpp"
 
+// Wait strategy used when RMW_GURUMDDS_WAIT_USE_POLLING=1 is set without explicit budgets
+#define RMW_GURUMDDS_DEFAULT_WAIT_SPIN_NS 50000
+#define RMW_GURUMDDS_DEFAULT_WAIT_YIELD_NS 1000000
+
+// Batch size from which rmw_take_sequence spreads deserialization over its threads
+#define RMW_GURUMDDS_DEFAULT_TAKE_SEQUENCE_PARALLEL_BYTES (1024 * 1024)
+
+static uint64_t
+get_env_uint64(const char * env_name, uint64_t default_value)
+{
+  const char * env_value = getenv(env_name);
+  if (env_value == nullptr || env_value[0] == '\0') {
+    return default_value;
+  }
+
+  char * end = nullptr;
+  unsigned long long value = strtoull(env_value, &end, 10);
+  if (*end != '\0') {
+    RCUTILS_LOG_WARN_NAMED(
+      RMW_GURUMDDS_ID, "ignoring invalid value of %s: '%s'", env_name, env_value);
+    return default_value;
+  }
+
+  return static_cast<uint64_t>(value);
+}
+
 extern "C"
 {
 rmw_ret_t
@@ -151,6 +181,31 @@ rmw_init(const rmw_init_options_t * options, rmw_context_t * context)
     service_mapping_basic = (strcmp(mapping_env_value, "basic") == 0);
   }
 
+  uint64_t wait_spin_ns = 0;
+  uint64_t wait_yield_ns = 0;
+  const char * polling_env_value = getenv("RMW_GURUMDDS_WAIT_USE_POLLING");
+  if (polling_env_value != nullptr && strcmp(polling_env_value, "1") == 0) {
+    wait_spin_ns = RMW_GURUMDDS_DEFAULT_WAIT_SPIN_NS;
+    wait_yield_ns = RMW_GURUMDDS_DEFAULT_WAIT_YIELD_NS;
+  }
+  wait_spin_ns = get_env_uint64("RMW_GURUMDDS_WAIT_SPIN_NS", wait_spin_ns);
+  wait_yield_ns = get_env_uint64("RMW_GURUMDDS_WAIT_YIELD_NS", wait_yield_ns);
+
+  const char * share_env_value = getenv("RMW_GURUMDDS_SHARE_CLIENT_ENDPOINTS");
+  bool share_client_endpoints = share_env_value != nullptr && strcmp(share_env_value, "1") == 0;
+
+  // More deserialization threads than the hardware runs at once only add overhead
+  uint64_t take_sequence_threads = get_env_uint64("RMW_GURUMDDS_TAKE_SEQUENCE_THREADS", 1);
+  const uint64_t hardware_threads = std::thread::hardware_concurrency();
+  if (hardware_threads > 0 && take_sequence_threads > hardware_threads) {
+    take_sequence_threads = hardware_threads;
+  }
+  if (take_sequence_threads == 0) {
+    take_sequence_threads = 1;
+  }
+  uint64_t take_sequence_parallel_bytes = get_env_uint64(
+    "RMW_GURUMDDS_TAKE_SEQUENCE_PARALLEL_BYTES", RMW_GURUMDDS_DEFAULT_TAKE_SEQUENCE_PARALLEL_BYTES);
+
   context->instance_id = options->instance_id;
   context->implementation_identifier = RMW_GURUMDDS_ID;
   context->actual_domain_id = RMW_DEFAULT_DOMAIN_ID != options->domain_id ? options->domain_id : 0u;
@@ -161,6 +216,11 @@ rmw_init(const rmw_init_options_t * options, rmw_context_t * context)
   }
   context->impl->is_shutdown = false;
   context->impl->service_mapping_basic = service_mapping_basic;
+  context->impl->wait_spin_ns = wait_spin_ns;
+  context->impl->wait_yield_ns = wait_yield_ns;
+  context->impl->share_client_endpoints = share_client_endpoints;
+  context->impl->take_sequence_threads = take_sequence_threads;
+  context->impl->take_sequence_parallel_bytes = take_sequence_parallel_bytes;
 
   ret = rmw_init_options_copy(options, &context->options);
   if (ret != RMW_RET_OK) {
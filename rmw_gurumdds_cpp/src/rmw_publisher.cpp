@@ -12,11 +12,14 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <algorithm>
 #include <string>
 #include <sstream>
 #include <limits>
 #include <thread>
 #include <chrono>
+#include <memory>
+#include <vector>
 
 #include "rcutils/error_handling.h"
 #include "rcutils/types.h"
@@ -34,11 +37,27 @@
 #include "rmw_gurumdds_cpp/identifier.hpp"
 #include "rmw_gurumdds_cpp/namespace_prefix.hpp"
 #include "rmw_gurumdds_cpp/names_and_types_helpers.hpp"
+#include "rmw_gurumdds_cpp/publisher_statistics.hpp"
 #include "rmw_gurumdds_cpp/qos.hpp"
 #include "rmw_gurumdds_cpp/rmw_context_impl.hpp"
 #include "rmw_gurumdds_cpp/rmw_publisher.hpp"
 #include "rmw_gurumdds_cpp/types.hpp"
 
+static void
+_on_publication_matched(
+  const dds_DataWriter * a_writer,
+  const dds_PublicationMatchedStatus * status)
+{
+  dds_DataWriter * writer = const_cast<dds_DataWriter *>(a_writer);
+  auto publisher_info = reinterpret_cast<GurumddsPublisherInfo *>(
+    dds_Entity_get_context(reinterpret_cast<dds_Entity *>(writer), 0));
+  if (publisher_info == nullptr || status == nullptr) {
+    return;
+  }
+
+  publisher_info->matched_subscriptions.update(status->total_count, status->current_count);
+}
+
 rmw_publisher_t *
 __rmw_create_publisher(
   rmw_context_impl_t * const ctx,
@@ -149,6 +168,8 @@ __rmw_create_publisher(
     dds_DataWriterQos_finalize(&datawriter_qos);
     return nullptr;
   }
+  const bool volatile_durability =
+    datawriter_qos.durability.kind == dds_VOLATILE_DURABILITY_QOS;
 
   ret = dds_DataWriterQos_finalize(&datawriter_qos);
   if (ret != dds_RETCODE_OK) {
@@ -156,17 +177,69 @@ __rmw_create_publisher(
     return nullptr;
   }
 
+  std::shared_ptr<SerializationPlan> serialization_plan =
+    create_serialization_plan(type_support->data, type_support->typesupport_identifier);
+  if (serialization_plan == nullptr) {
+    // Error message already set
+    return nullptr;
+  }
+
   publisher_info = new(std::nothrow) GurumddsPublisherInfo();
   if (publisher_info == nullptr) {
     RMW_SET_ERROR_MSG("failed to allocate GurumddsPublisherInfo");
     return nullptr;
   }
 
+  if (!publisher_info->matched_subscriptions.init()) {
+    RMW_SET_ERROR_MSG("failed to create guard condition");
+    delete publisher_info;
+    return nullptr;
+  }
+
   publisher_info->topic_writer = topic_writer;
   publisher_info->rosidl_message_typesupport = type_support;
   publisher_info->implementation_identifier = RMW_GURUMDDS_ID;
-  publisher_info->sequence_number = 0;
   publisher_info->ctx = ctx;
+  publisher_info->serialization_plan = serialization_plan;
+  publisher_info->volatile_durability = volatile_durability;
+  if (serialization_plan->is_fixed_size()) {
+    // Leave room to pad a plain message up to its serialized size in place
+    publisher_info->loan_pool.init(
+      std::max(
+        serialization_plan->get_message_size(),
+        serialization_plan->get_fixed_serialized_size()));
+  }
+  if (serialization_plan->get_max_serialized_size() > 0) {
+    // Small bounded messages never reallocate the retained buffer once it has room for the
+    // largest one. Only capacity is reserved, so nothing is written until a message needs it.
+    try {
+      publisher_info->serialization_buffer.reserve(
+        std::min<size_t>(serialization_plan->get_max_serialized_size(), CDR_MAX_PRESIZE));
+    } catch (std::bad_alloc &) {
+      // The buffer grows on demand instead
+    }
+  }
+
+  dds_Entity_set_context(
+    reinterpret_cast<dds_Entity *>(topic_writer), 0, reinterpret_cast<void *>(publisher_info));
+  dds_DataWriterListener writer_listener;
+  memset(&writer_listener, 0, sizeof(writer_listener));
+  writer_listener.on_publication_matched = _on_publication_matched;
+  ret = dds_DataWriter_set_listener(
+    topic_writer, &writer_listener, dds_PUBLICATION_MATCHED_STATUS);
+  if (ret != dds_RETCODE_OK) {
+    RMW_SET_ERROR_MSG("failed to set datawriter listener");
+    delete publisher_info;
+    return nullptr;
+  }
+
+  {
+    // Matches made before the listener was set
+    dds_PublicationMatchedStatus status;
+    if (dds_DataWriter_get_publication_matched_status(topic_writer, &status) == dds_RETCODE_OK) {
+      publisher_info->matched_subscriptions.update(status.total_count, status.current_count);
+    }
+  }
 
   entity_get_gid(
     reinterpret_cast<dds_Entity *>(publisher_info->topic_writer),
@@ -200,7 +273,7 @@ __rmw_create_publisher(
     topic_name,
     strlen(topic_name) + 1);
   rmw_publisher->options = *publisher_options;
-  rmw_publisher->can_loan_messages = false;
+  rmw_publisher->can_loan_messages = serialization_plan->is_fixed_size();
 
   if (!internal) {
     if (graph_on_publisher_created(ctx, node, publisher_info) != RMW_RET_OK) {
@@ -232,6 +305,10 @@ __rmw_destroy_publisher(
   dds_ReturnCode_t ret;
   if (publisher_info->topic_writer != nullptr) {
     dds_Topic * topic = dds_DataWriter_get_topic(publisher_info->topic_writer);
+    wait_sets_forget_condition(
+      reinterpret_cast<dds_Condition *>(
+        dds_DataWriter_get_statuscondition(publisher_info->topic_writer)));
+    dds_DataWriter_set_listener(publisher_info->topic_writer, nullptr, 0);
     ret = dds_Publisher_delete_datawriter(ctx->publisher, publisher_info->topic_writer);
     if (ret != dds_RETCODE_OK) {
       RMW_SET_ERROR_MSG("failed to delete datawriter");
@@ -254,29 +331,245 @@ __rmw_destroy_publisher(
   return RMW_RET_OK;
 }
 
+static rmw_ret_t
+_write_sample(
+  const rmw_publisher_t * publisher,
+  GurumddsPublisherInfo * publisher_info,
+  const void * data,
+  size_t size)
+{
+  dds_SampleInfoEx sampleinfo_ex;
+  memset(&sampleinfo_ex, 0, sizeof(dds_SampleInfoEx));
+  int64_t sequence_number = publisher_info->sequence_number.fetch_add(1) + 1;
+  ros_sn_to_dds_sn(sequence_number, &sampleinfo_ex.seq);
+  ros_guid_to_dds_guid(
+    publisher_info->publisher_gid.data,
+    reinterpret_cast<uint8_t *>(&sampleinfo_ex.src_guid));
+
+  dds_ReturnCode_t ret = dds_DataWriter_raw_write_w_sampleinfoex(
+    publisher_info->topic_writer,
+    data,
+    static_cast<uint32_t>(size),
+    &sampleinfo_ex
+  );
+
+  const char * errstr;
+  if (ret == dds_RETCODE_OK) {
+    errstr = "dds_RETCODE_OK";
+  } else if (ret == dds_RETCODE_TIMEOUT) {
+    errstr = "dds_RETCODE_TIMEOUT";
+  } else if (ret == dds_RETCODE_OUT_OF_RESOURCES) {
+    errstr = "dds_RETCODE_OUT_OF_RESOURCES";
+  } else {
+    errstr = "dds_RETCODE_ERROR";
+  }
+
+  if (ret != dds_RETCODE_OK) {
+    std::stringstream errmsg;
+    errmsg << "failed to publish data: " << errstr << ", " << ret;
+    RMW_SET_ERROR_MSG(errmsg.str().c_str());
+    return RMW_RET_ERROR;
+  }
+
+  publisher_info->written_count.fetch_add(1, std::memory_order_relaxed);
+  RCUTILS_LOG_DEBUG_NAMED(RMW_GURUMDDS_ID, "Published data on topic %s", publisher->topic_name);
+
+  return RMW_RET_OK;
+}
+
+// Skips a message that not even a late joining subscription could receive. Its sequence number
+// is still used up, so that sequence numbers reveal the skipped messages.
+static bool
+_skip_unmatched(GurumddsPublisherInfo * publisher_info)
+{
+  if (!publisher_info->volatile_durability ||
+    publisher_info->matched_subscriptions.current_count() != 0)
+  {
+    return false;
+  }
+
+  publisher_info->sequence_number.fetch_add(1);
+  publisher_info->skipped_count.fetch_add(1, std::memory_order_relaxed);
+  return true;
+}
+
+static rmw_ret_t
+_serialize_and_write(
+  const rmw_publisher_t * publisher,
+  GurumddsPublisherInfo * publisher_info,
+  const void * ros_message,
+  GurumddsPublisherAllocation * allocation_info)
+{
+  const rosidl_message_type_support_t * rosidl_typesupport =
+    publisher_info->rosidl_message_typesupport;
+  if (rosidl_typesupport == nullptr) {
+    RMW_SET_ERROR_MSG("rosidl typesupport handle is null");
+    return RMW_RET_ERROR;
+  }
+
+  if (_skip_unmatched(publisher_info)) {
+    return RMW_RET_OK;
+  }
+
+  size_t size = 0;
+  // A preallocated buffer is used when given. Otherwise a concurrent publish on the same
+  // publisher falls back to a temporary buffer.
+  std::unique_lock<std::mutex> buffer_lock;
+  std::vector<uint8_t> temporary_buffer;
+  std::vector<uint8_t> * buffer = &temporary_buffer;
+  if (allocation_info != nullptr) {
+    buffer = &allocation_info->serialization_buffer;
+  } else {
+    buffer_lock = std::unique_lock<std::mutex>(
+      publisher_info->serialization_mutex, std::try_to_lock);
+    if (buffer_lock.owns_lock()) {
+      buffer = &publisher_info->serialization_buffer;
+    }
+  }
+  std::vector<uint8_t> & dds_message = *buffer;
+  bool result = serialize_ros_to_cdr(
+    rosidl_typesupport->data,
+    rosidl_typesupport->typesupport_identifier,
+    ros_message,
+    dds_message,
+    &size,
+    publisher_info->serialization_plan.get()
+  );
+  if (!result) {
+    RMW_SET_ERROR_MSG("failed to serialize message");
+    return RMW_RET_ERROR;
+  }
+
+  return _write_sample(publisher, publisher_info, dds_message.data(), size);
+}
+
+static rmw_ret_t
+_get_publisher_allocation(
+  GurumddsPublisherInfo * publisher_info,
+  rmw_publisher_allocation_t * allocation,
+  GurumddsPublisherAllocation ** allocation_info)
+{
+  *allocation_info = nullptr;
+  if (allocation == nullptr) {
+    return RMW_RET_OK;
+  }
+
+  RMW_CHECK_TYPE_IDENTIFIERS_MATCH(
+    allocation,
+    allocation->implementation_identifier,
+    RMW_GURUMDDS_ID,
+    return RMW_RET_INCORRECT_RMW_IMPLEMENTATION);
+
+  auto info = static_cast<GurumddsPublisherAllocation *>(allocation->data);
+  RCUTILS_CHECK_ARGUMENT_FOR_NULL(info, RMW_RET_ERROR);
+
+  if (info->type_support_data != publisher_info->rosidl_message_typesupport->data) {
+    RMW_SET_ERROR_MSG("allocation was initialized for a different message type");
+    return RMW_RET_INVALID_ARGUMENT;
+  }
+
+  *allocation_info = info;
+  return RMW_RET_OK;
+}
+
+// Loaned messages of plain types already hold their CDR payload. Their block has room for the
+// CDR header and the alignment padding, so they are written without being serialized.
+static rmw_ret_t
+_write_loaned_plain(
+  const rmw_publisher_t * publisher,
+  GurumddsPublisherInfo * publisher_info,
+  void * ros_message)
+{
+  const SerializationPlan & plan = *publisher_info->serialization_plan;
+  uint8_t * payload = static_cast<uint8_t *>(ros_message);
+  uint8_t * sample = payload - CDR_HEADER_SIZE;
+  size_t size = plan.get_fixed_serialized_size();
+
+  memset(sample, 0, CDR_HEADER_SIZE);
+  sample[CDR_HEADER_ENDIAN_IDX] = system_endian;
+  memset(
+    payload + plan.get_plain_size(), 0, size - CDR_HEADER_SIZE - plan.get_plain_size());
+
+  return _write_sample(publisher, publisher_info, sample, size);
+}
+
 extern "C"
 {
 rmw_ret_t
 rmw_init_publisher_allocation(
-  const rosidl_message_type_support_t * type_support,
+  const rosidl_message_type_support_t * type_supports,
   const rosidl_runtime_c__Sequence__bound * message_bounds,
   rmw_publisher_allocation_t * allocation)
 {
-  (void)type_support;
   (void)message_bounds;
-  (void)allocation;
+  RMW_CHECK_ARGUMENT_FOR_NULL(type_supports, RMW_RET_INVALID_ARGUMENT);
+  RMW_CHECK_ARGUMENT_FOR_NULL(allocation, RMW_RET_INVALID_ARGUMENT);
+
+  const rosidl_message_type_support_t * type_support =
+    get_message_typesupport_handle(type_supports, rosidl_typesupport_introspection_c__identifier);
+  if (type_support == nullptr) {
+    rcutils_reset_error();
+    type_support = get_message_typesupport_handle(
+      type_supports, rosidl_typesupport_introspection_cpp::typesupport_identifier);
+    if (type_support == nullptr) {
+      rcutils_reset_error();
+      RMW_SET_ERROR_MSG("type support not from this implementation");
+      return RMW_RET_INCORRECT_RMW_IMPLEMENTATION;
+    }
+  }
+
+  std::shared_ptr<SerializationPlan> serialization_plan =
+    create_serialization_plan(type_support->data, type_support->typesupport_identifier);
+  if (serialization_plan == nullptr) {
+    // Error message already set
+    return RMW_RET_ERROR;
+  }
 
-  RMW_SET_ERROR_MSG("rmw_init_publisher_allocation is not supported");
-  return RMW_RET_UNSUPPORTED;
+  size_t max_serialized_size = serialization_plan->get_max_serialized_size();
+  if (max_serialized_size == 0) {
+    RMW_SET_ERROR_MSG("publisher allocation requires a bounded message type");
+    return RMW_RET_UNSUPPORTED;
+  }
+
+  auto allocation_info = new(std::nothrow) GurumddsPublisherAllocation();
+  if (allocation_info == nullptr) {
+    RMW_SET_ERROR_MSG("failed to allocate GurumddsPublisherAllocation");
+    return RMW_RET_BAD_ALLOC;
+  }
+
+  // The caller asked for the storage up front, so the whole size is reserved. It is only
+  // reserved, so pages the messages never reach are not written.
+  try {
+    allocation_info->serialization_buffer.reserve(
+      std::max<size_t>(max_serialized_size, CDR_MIN_GROWABLE_SIZE));
+  } catch (std::bad_alloc &) {
+    RMW_SET_ERROR_MSG("failed to allocate serialization buffer");
+    delete allocation_info;
+    return RMW_RET_BAD_ALLOC;
+  }
+  allocation_info->type_support_data = type_support->data;
+
+  allocation->implementation_identifier = RMW_GURUMDDS_ID;
+  allocation->data = allocation_info;
+
+  return RMW_RET_OK;
 }
 
 rmw_ret_t
 rmw_fini_publisher_allocation(rmw_publisher_allocation_t * allocation)
 {
-  (void)allocation;
+  RMW_CHECK_ARGUMENT_FOR_NULL(allocation, RMW_RET_INVALID_ARGUMENT);
+  RMW_CHECK_TYPE_IDENTIFIERS_MATCH(
+    allocation,
+    allocation->implementation_identifier,
+    RMW_GURUMDDS_ID,
+    return RMW_RET_INCORRECT_RMW_IMPLEMENTATION);
+
+  delete static_cast<GurumddsPublisherAllocation *>(allocation->data);
+  allocation->implementation_identifier = nullptr;
+  allocation->data = nullptr;
 
-  RMW_SET_ERROR_MSG("rmw_fini_publisher_allocation is not supported");
-  return RMW_RET_UNSUPPORTED;
+  return RMW_RET_OK;
 }
 
 rmw_publisher_t *
@@ -376,15 +669,9 @@ rmw_publisher_count_matched_subscriptions(
     return RMW_RET_ERROR;
   }
 
-  dds_InstanceHandleSeq * seq = dds_InstanceHandleSeq_create(4);
-  if (dds_DataWriter_get_matched_subscriptions(topic_writer, seq) != dds_RETCODE_OK) {
-    RMW_SET_ERROR_MSG("failed to get matched subscriptions");
-    dds_InstanceHandleSeq_delete(seq);
-    return RMW_RET_ERROR;
-  }
-  *subscription_count = static_cast<size_t>(dds_InstanceHandleSeq_length(seq));
-
-  dds_InstanceHandleSeq_delete(seq);
+  // Kept by the publication matched listener
+  *subscription_count =
+    static_cast<size_t>(publisher_info->matched_subscriptions.current_count());
 
   return RMW_RET_OK;
 }
@@ -564,7 +851,6 @@ rmw_publish(
   const void * ros_message,
   rmw_publisher_allocation_t * allocation)
 {
-  (void)allocation;
   RMW_CHECK_ARGUMENT_FOR_NULL(publisher, RMW_RET_INVALID_ARGUMENT);
   RMW_CHECK_ARGUMENT_FOR_NULL(ros_message, RMW_RET_INVALID_ARGUMENT);
   RMW_CHECK_TYPE_IDENTIFIERS_MATCH(
@@ -579,73 +865,13 @@ rmw_publish(
   dds_DataWriter * topic_writer = publisher_info->topic_writer;
   RCUTILS_CHECK_ARGUMENT_FOR_NULL(topic_writer, RMW_RET_ERROR);
 
-  const rosidl_message_type_support_t * rosidl_typesupport =
-    publisher_info->rosidl_message_typesupport;
-  if (rosidl_typesupport == nullptr) {
-    RMW_SET_ERROR_MSG("rosidl typesupport handle is null");
-    return RMW_RET_ERROR;
-  }
-
-  size_t size = 0;
-  void * dds_message = allocate_message(
-    rosidl_typesupport->data,
-    rosidl_typesupport->typesupport_identifier,
-    ros_message,
-    &size,
-    false
-  );
-  if (dds_message == nullptr) {
-    // Error message already set
-    return RMW_RET_ERROR;
-  }
-
-  bool result = serialize_ros_to_cdr(
-    rosidl_typesupport->data,
-    rosidl_typesupport->typesupport_identifier,
-    ros_message,
-    dds_message,
-    size
-  );
-  if (!result) {
-    RMW_SET_ERROR_MSG("failed to serialize message");
-    free(dds_message);
-    return RMW_RET_ERROR;
-  }
-
-  dds_SampleInfoEx sampleinfo_ex;
-  memset(&sampleinfo_ex, 0, sizeof(dds_SampleInfoEx));
-  ros_sn_to_dds_sn(++publisher_info->sequence_number, &sampleinfo_ex.seq);
-  ros_guid_to_dds_guid(
-    publisher_info->publisher_gid.data,
-    reinterpret_cast<uint8_t *>(&sampleinfo_ex.src_guid));
-
-  dds_ReturnCode_t ret = dds_DataWriter_raw_write_w_sampleinfoex(
-    topic_writer, dds_message, size, &sampleinfo_ex);
-
-  const char * errstr;
-  if (ret == dds_RETCODE_OK) {
-    errstr = "dds_RETCODE_OK";
-  } else if (ret == dds_RETCODE_TIMEOUT) {
-    errstr = "dds_RETCODE_TIMEOUT";
-  } else if (ret == dds_RETCODE_OUT_OF_RESOURCES) {
-    errstr = "dds_RETCODE_OUT_OF_RESOURCES";
-  } else {
-    errstr = "dds_RETCODE_ERROR";
-  }
-
-  if (ret != dds_RETCODE_OK) {
-    std::stringstream errmsg;
-    errmsg << "failed to publish data: " << errstr << ", " << ret;
-    RMW_SET_ERROR_MSG(errmsg.str().c_str());
-    free(dds_message);
-    return RMW_RET_ERROR;
+  GurumddsPublisherAllocation * allocation_info = nullptr;
+  rmw_ret_t ret = _get_publisher_allocation(publisher_info, allocation, &allocation_info);
+  if (ret != RMW_RET_OK) {
+    return ret;
   }
 
-  RCUTILS_LOG_DEBUG_NAMED(RMW_GURUMDDS_ID, "Published data on topic %s", publisher->topic_name);
-
-  free(dds_message);
-
-  return RMW_RET_OK;
+  return _serialize_and_write(publisher, publisher_info, ros_message, allocation_info);
 }
 
 rmw_ret_t
@@ -669,41 +895,8 @@ rmw_publish_serialized_message(
   dds_DataWriter * topic_writer = publisher_info->topic_writer;
   RCUTILS_CHECK_ARGUMENT_FOR_NULL(topic_writer, RMW_RET_ERROR);
 
-  dds_SampleInfoEx sampleinfo_ex;
-  memset(&sampleinfo_ex, 0, sizeof(dds_SampleInfoEx));
-  ros_sn_to_dds_sn(++publisher_info->sequence_number, &sampleinfo_ex.seq);
-  ros_guid_to_dds_guid(
-    publisher_info->publisher_gid.data,
-    reinterpret_cast<uint8_t *>(&sampleinfo_ex.src_guid));
-
-  dds_ReturnCode_t ret = dds_DataWriter_raw_write_w_sampleinfoex(
-    topic_writer,
-    serialized_message->buffer,
-    static_cast<uint32_t>(serialized_message->buffer_length),
-    &sampleinfo_ex
-  );
-
-  const char * errstr;
-  if (ret == dds_RETCODE_OK) {
-    errstr = "dds_RETCODE_OK";
-  } else if (ret == dds_RETCODE_TIMEOUT) {
-    errstr = "dds_RETCODE_TIMEOUT";
-  } else if (ret == dds_RETCODE_OUT_OF_RESOURCES) {
-    errstr = "dds_RETCODE_OUT_OF_RESOURCES";
-  } else {
-    errstr = "dds_RETCODE_ERROR";
-  }
-
-  if (ret != dds_RETCODE_OK) {
-    std::stringstream errmsg;
-    errmsg << "failed to publish data: " << errstr << ", " << ret;
-    RMW_SET_ERROR_MSG(errmsg.str().c_str());
-    return RMW_RET_ERROR;
-  }
-
-  RCUTILS_LOG_DEBUG_NAMED(RMW_GURUMDDS_ID, "Published data on topic %s", publisher->topic_name);
-
-  return RMW_RET_OK;
+  return _write_sample(
+    publisher, publisher_info, serialized_message->buffer, serialized_message->buffer_length);
 }
 
 rmw_ret_t
@@ -712,12 +905,40 @@ rmw_publish_loaned_message(
   void * ros_message,
   rmw_publisher_allocation_t * allocation)
 {
-  (void)publisher;
-  (void)ros_message;
-  (void)allocation;
+  RMW_CHECK_ARGUMENT_FOR_NULL(publisher, RMW_RET_INVALID_ARGUMENT);
+  RMW_CHECK_ARGUMENT_FOR_NULL(ros_message, RMW_RET_INVALID_ARGUMENT);
+  RMW_CHECK_TYPE_IDENTIFIERS_MATCH(
+    publisher,
+    publisher->implementation_identifier,
+    RMW_GURUMDDS_ID,
+    return RMW_RET_INCORRECT_RMW_IMPLEMENTATION);
+
+  if (!publisher->can_loan_messages) {
+    RMW_SET_ERROR_MSG("Loaning is not supported");
+    return RMW_RET_UNSUPPORTED;
+  }
 
-  RMW_SET_ERROR_MSG("rmw_publish_loaned_message is not supported");
-  return RMW_RET_UNSUPPORTED;
+  auto publisher_info = static_cast<GurumddsPublisherInfo *>(publisher->data);
+  RCUTILS_CHECK_ARGUMENT_FOR_NULL(publisher_info, RMW_RET_ERROR);
+
+  dds_DataWriter * topic_writer = publisher_info->topic_writer;
+  RCUTILS_CHECK_ARGUMENT_FOR_NULL(topic_writer, RMW_RET_ERROR);
+
+  GurumddsPublisherAllocation * allocation_info = nullptr;
+  rmw_ret_t ret = _get_publisher_allocation(publisher_info, allocation, &allocation_info);
+  if (ret == RMW_RET_OK && !_skip_unmatched(publisher_info)) {
+    if (publisher_info->serialization_plan->get_plain_size() > 0) {
+      ret = _write_loaned_plain(publisher, publisher_info, ros_message);
+    } else {
+      ret = _serialize_and_write(publisher, publisher_info, ros_message, allocation_info);
+    }
+  }
+
+  // The loan is given back to the publisher whether or not the write succeeded
+  publisher_info->serialization_plan->fini_message(ros_message);
+  publisher_info->loan_pool.release(ros_message);
+
+  return ret;
 }
 
 rmw_ret_t
@@ -726,12 +947,38 @@ rmw_borrow_loaned_message(
   const rosidl_message_type_support_t * type_support,
   void ** ros_message)
 {
-  (void)publisher;
-  (void)type_support;
-  (void)ros_message;
+  RMW_CHECK_ARGUMENT_FOR_NULL(publisher, RMW_RET_INVALID_ARGUMENT);
+  RMW_CHECK_ARGUMENT_FOR_NULL(type_support, RMW_RET_INVALID_ARGUMENT);
+  RMW_CHECK_ARGUMENT_FOR_NULL(ros_message, RMW_RET_INVALID_ARGUMENT);
+  RMW_CHECK_TYPE_IDENTIFIERS_MATCH(
+    publisher,
+    publisher->implementation_identifier,
+    RMW_GURUMDDS_ID,
+    return RMW_RET_INCORRECT_RMW_IMPLEMENTATION);
+
+  if (!publisher->can_loan_messages) {
+    RMW_SET_ERROR_MSG("Loaning is not supported");
+    return RMW_RET_UNSUPPORTED;
+  }
+
+  if (*ros_message != nullptr) {
+    RMW_SET_ERROR_MSG("ros_message is not null");
+    return RMW_RET_INVALID_ARGUMENT;
+  }
+
+  auto publisher_info = static_cast<GurumddsPublisherInfo *>(publisher->data);
+  RCUTILS_CHECK_ARGUMENT_FOR_NULL(publisher_info, RMW_RET_ERROR);
+
+  void * message = publisher_info->loan_pool.acquire();
+  if (message == nullptr) {
+    RMW_SET_ERROR_MSG("failed to allocate loaned message");
+    return RMW_RET_BAD_ALLOC;
+  }
 
-  RMW_SET_ERROR_MSG("rmw_borrow_loaned_message is not supported");
-  return RMW_RET_UNSUPPORTED;
+  publisher_info->serialization_plan->init_message(message);
+  *ros_message = message;
+
+  return RMW_RET_OK;
 }
 
 rmw_ret_t
@@ -739,10 +986,53 @@ rmw_return_loaned_message_from_publisher(
   const rmw_publisher_t * publisher,
   void * loaned_message)
 {
-  (void)publisher;
-  (void)loaned_message;
+  RMW_CHECK_ARGUMENT_FOR_NULL(publisher, RMW_RET_INVALID_ARGUMENT);
+  RMW_CHECK_ARGUMENT_FOR_NULL(loaned_message, RMW_RET_INVALID_ARGUMENT);
+  RMW_CHECK_TYPE_IDENTIFIERS_MATCH(
+    publisher,
+    publisher->implementation_identifier,
+    RMW_GURUMDDS_ID,
+    return RMW_RET_INCORRECT_RMW_IMPLEMENTATION);
+
+  if (!publisher->can_loan_messages) {
+    RMW_SET_ERROR_MSG("Loaning is not supported");
+    return RMW_RET_UNSUPPORTED;
+  }
+
+  auto publisher_info = static_cast<GurumddsPublisherInfo *>(publisher->data);
+  RCUTILS_CHECK_ARGUMENT_FOR_NULL(publisher_info, RMW_RET_ERROR);
+
+  publisher_info->serialization_plan->fini_message(loaned_message);
+  publisher_info->loan_pool.release(loaned_message);
 
-  RMW_SET_ERROR_MSG("rmw_return_loaned_message_from_publisher is not supported");
-  return RMW_RET_UNSUPPORTED;
+  return RMW_RET_OK;
 }
 }  // extern "C"
+
+namespace rmw_gurumdds_cpp
+{
+rmw_ret_t
+get_publisher_statistics(
+  const rmw_publisher_t * publisher,
+  PublisherStatistics * statistics)
+{
+  RMW_CHECK_ARGUMENT_FOR_NULL(publisher, RMW_RET_INVALID_ARGUMENT);
+  RMW_CHECK_TYPE_IDENTIFIERS_MATCH(
+    publisher,
+    publisher->implementation_identifier,
+    RMW_GURUMDDS_ID,
+    return RMW_RET_INCORRECT_RMW_IMPLEMENTATION);
+  RMW_CHECK_ARGUMENT_FOR_NULL(statistics, RMW_RET_INVALID_ARGUMENT);
+
+  auto publisher_info = static_cast<GurumddsPublisherInfo *>(publisher->data);
+  if (publisher_info == nullptr) {
+    RMW_SET_ERROR_MSG("publisher internal data is invalid");
+    return RMW_RET_ERROR;
+  }
+
+  statistics->written_count = publisher_info->written_count.load(std::memory_order_relaxed);
+  statistics->skipped_count = publisher_info->skipped_count.load(std::memory_order_relaxed);
+
+  return RMW_RET_OK;
+}
+}  // namespace rmw_gurumdds_cpp
@@ -12,6 +12,8 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <memory>
+
 #include "rmw/error_handling.h"
 #include "rmw/serialized_message.h"
 #include "rmw/rmw.h"
@@ -37,41 +39,48 @@ rmw_serialize(
     }
   }
 
-  ssize_t ssize = get_serialized_size(
-    ts->data,
-    ts->typesupport_identifier,
-    ros_message
-  );
-  if (ssize < 0) {
-    RMW_SET_ERROR_MSG("failed to get size of serialized message");
+  std::shared_ptr<SerializationPlan> plan =
+    create_serialization_plan(ts->data, ts->typesupport_identifier);
+  if (plan == nullptr) {
+    // Error message already set
     return RMW_RET_ERROR;
   }
 
-  size_t size = static_cast<size_t>(ssize);
+  // Small bounded types are sized by their largest message, others take a counting pass
+  // first, so either way the message is serialized straight into the caller's buffer
+  size_t needed = plan->get_max_serialized_size();
+  if (needed == 0 || needed > CDR_MAX_PRESIZE) {
+    ssize_t counted = get_serialized_size(ts->data, ts->typesupport_identifier, ros_message);
+    if (counted < 0) {
+      // Error message already set
+      return RMW_RET_ERROR;
+    }
+    needed = static_cast<size_t>(counted);
+  }
 
-  serialized_message->buffer_length = size;
-  if (serialized_message->buffer_capacity < size) {
-    serialized_message->allocator.deallocate(
-      serialized_message->buffer, serialized_message->allocator.state);
-    serialized_message->buffer = static_cast<uint8_t *>(
-      serialized_message->allocator.allocate(
-        serialized_message->buffer_length,
-        serialized_message->allocator.state));
-    serialized_message->buffer_capacity = size;
+  if (serialized_message->buffer_capacity < needed) {
+    if (rmw_serialized_message_resize(serialized_message, needed) != RMW_RET_OK) {
+      // Error message already set
+      return RMW_RET_ERROR;
+    }
   }
 
+  size_t size = 0;
   bool res = serialize_ros_to_cdr(
     ts->data,
     ts->typesupport_identifier,
     ros_message,
     serialized_message->buffer,
-    size
+    serialized_message->buffer_capacity,
+    &size,
+    plan.get()
   );
   if (!res) {
     // Error message already set
     return RMW_RET_ERROR;
   }
 
+  serialized_message->buffer_length = size;
   return RMW_RET_OK;
 }
 
@@ -92,12 +101,20 @@ rmw_deserialize(
     }
   }
 
+  std::shared_ptr<SerializationPlan> plan =
+    create_serialization_plan(ts->data, ts->typesupport_identifier);
+  if (plan == nullptr) {
+    // Error message already set
+    return RMW_RET_ERROR;
+  }
+
   bool res = deserialize_cdr_to_ros(
     ts->data,
     ts->typesupport_identifier,
     ros_message,
     serialized_message->buffer,
-    serialized_message->buffer_length
+    serialized_message->buffer_length,
+    plan.get()
   );
   if (!res) {
     // Error message already set
@@ -109,11 +126,40 @@ rmw_deserialize(
 
 rmw_ret_t
 rmw_get_serialized_message_size(
-  const rosidl_message_type_support_t * /*type_support*/,
-  const rosidl_runtime_c__Sequence__bound * /*message_bounds*/,
-  size_t * /*size*/)
+  const rosidl_message_type_support_t * type_support,
+  const rosidl_runtime_c__Sequence__bound * message_bounds,
+  size_t * size)
 {
-  RMW_SET_ERROR_MSG("unimplemented");
-  return RMW_RET_UNSUPPORTED;
+  // rosidl does not define the contents of message_bounds and no generator produces them,
+  // so only the bounds declared by the type itself are known
+  (void)message_bounds;
+  RMW_CHECK_ARGUMENT_FOR_NULL(type_support, RMW_RET_INVALID_ARGUMENT);
+  RMW_CHECK_ARGUMENT_FOR_NULL(size, RMW_RET_INVALID_ARGUMENT);
+
+  const rosidl_message_type_support_t * ts =
+    get_message_typesupport_handle(type_support, rosidl_typesupport_introspection_c__identifier);
+  if (ts == nullptr) {
+    ts = get_message_typesupport_handle(
+      type_support, rosidl_typesupport_introspection_cpp::typesupport_identifier);
+    if (ts == nullptr) {
+      RMW_SET_ERROR_MSG("type support not from this implementation");
+      return RMW_RET_ERROR;
+    }
+  }
+
+  std::shared_ptr<SerializationPlan> plan =
+    create_serialization_plan(ts->data, ts->typesupport_identifier);
+  if (plan == nullptr) {
+    // Error message already set
+    return RMW_RET_ERROR;
+  }
+
+  if (plan->get_max_serialized_size() == 0) {
+    RMW_SET_ERROR_MSG("message type has an unbounded string or sequence");
+    return RMW_RET_UNSUPPORTED;
+  }
+
+  *size = plan->get_max_serialized_size();
+  return RMW_RET_OK;
 }
 }  // extern "C"
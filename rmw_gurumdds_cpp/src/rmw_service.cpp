@@ -16,6 +16,7 @@
 #include <string>
 #include <thread>
 #include <utility>
+#include <vector>
 
 #include "rcutils/logging_macros.h"
 #include "rcutils/error_handling.h"
@@ -37,6 +38,19 @@
 
 #include "type_support_service.hpp"
 
+static void
+_on_request_available(const dds_DataReader * a_reader)
+{
+  dds_DataReader * reader = const_cast<dds_DataReader *>(a_reader);
+  auto service_info = reinterpret_cast<GurumddsServiceInfo *>(
+    dds_Entity_get_context(reinterpret_cast<dds_Entity *>(reader), 0));
+  if (service_info == nullptr) {
+    return;
+  }
+
+  service_info->new_request_callback.notify(1);
+}
+
 extern "C"
 {
 rmw_service_t *
@@ -109,6 +123,7 @@ rmw_create_service(
   dds_Topic * request_topic = nullptr;
   dds_Topic * response_topic = nullptr;
 
+  dds_DataReaderListener request_listener;
   dds_ReturnCode_t ret;
 
   std::pair<std::string, std::string> service_type_name;
@@ -153,6 +168,11 @@ rmw_create_service(
     goto fail;
   }
 
+  if (!service_info->take_sequences.init(1)) {
+    RMW_SET_ERROR_MSG("failed to create take sequences");
+    goto fail;
+  }
+
   service_info->implementation_identifier = RMW_GURUMDDS_ID;
   service_info->service_typesupport = type_support;
   service_info->ctx = ctx;
@@ -285,6 +305,17 @@ rmw_create_service(
   }
   service_info->read_condition = read_condition;
 
+  // Requests are counted from here on, even before a new request callback is set
+  dds_Entity_set_context(
+    reinterpret_cast<dds_Entity *>(request_reader), 0, reinterpret_cast<void *>(service_info));
+  memset(&request_listener, 0, sizeof(request_listener));
+  request_listener.on_data_available = _on_request_available;
+  ret = dds_DataReader_set_listener(request_reader, &request_listener, dds_DATA_AVAILABLE_STATUS);
+  if (ret != dds_RETCODE_OK) {
+    RMW_SET_ERROR_MSG("failed to set datareader listener");
+    goto fail;
+  }
+
   if (!get_datawriter_qos(publisher, qos_policies, &datawriter_qos)) {
     // Error message already set
     goto fail;
@@ -419,7 +450,10 @@ rmw_destroy_service(rmw_node_t * node, rmw_service_t * service)
     }
 
     if (service_info->request_reader != nullptr) {
+      dds_DataReader_set_listener(service_info->request_reader, nullptr, 0);
       if (service_info->read_condition != nullptr) {
+        wait_sets_forget_condition(
+          reinterpret_cast<dds_Condition *>(service_info->read_condition));
         ret = dds_DataReader_delete_readcondition(
           service_info->request_reader, service_info->read_condition);
         if (ret != dds_RETCODE_OK) {
@@ -592,26 +626,14 @@ rmw_take_request(
     return RMW_RET_ERROR;
   }
 
-  dds_DataSeq * data_values = dds_DataSeq_create(1);
-  if (data_values == nullptr) {
-    RMW_SET_ERROR_MSG("failed to create data sequence");
-    return RMW_RET_ERROR;
-  }
-
-  dds_SampleInfoSeq * sample_infos = dds_SampleInfoSeq_create(1);
-  if (sample_infos == nullptr) {
-    RMW_SET_ERROR_MSG("failed to create sample info sequence");
-    dds_DataSeq_delete(data_values);
-    return RMW_RET_ERROR;
-  }
-
-  dds_UnsignedLongSeq * sample_sizes = dds_UnsignedLongSeq_create(1);
-  if (sample_sizes == nullptr) {
-    RMW_SET_ERROR_MSG("failed to create sample size sequence");
-    dds_DataSeq_delete(data_values);
-    dds_SampleInfoSeq_delete(sample_infos);
+  TakeSequencesGuard sequences(service_info->take_sequences);
+  if (!sequences.is_valid()) {
+    RMW_SET_ERROR_MSG("failed to create take sequences");
     return RMW_RET_ERROR;
   }
+  dds_DataSeq * data_values = sequences.data_values;
+  dds_SampleInfoSeq * sample_infos = sequences.sample_infos;
+  dds_UnsignedLongSeq * sample_sizes = sequences.sample_sizes;
 
   if (service_info->ctx->service_mapping_basic) {
     dds_ReturnCode_t ret = dds_DataReader_raw_take(
@@ -620,18 +642,12 @@ rmw_take_request(
 
     if (ret == dds_RETCODE_NO_DATA) {
       dds_DataReader_raw_return_loan(request_reader, data_values, sample_infos, sample_sizes);
-      dds_DataSeq_delete(data_values);
-      dds_SampleInfoSeq_delete(sample_infos);
-      dds_UnsignedLongSeq_delete(sample_sizes);
       return RMW_RET_OK;
     }
 
     if (ret != dds_RETCODE_OK) {
       RMW_SET_ERROR_MSG("failed to take data");
       dds_DataReader_raw_return_loan(request_reader, data_values, sample_infos, sample_sizes);
-      dds_DataSeq_delete(data_values);
-      dds_SampleInfoSeq_delete(sample_infos);
-      dds_UnsignedLongSeq_delete(sample_sizes);
       return RMW_RET_ERROR;
     }
 
@@ -640,9 +656,6 @@ rmw_take_request(
       void * sample = dds_DataSeq_get(data_values, 0);
       if (sample == nullptr) {
         dds_DataReader_raw_return_loan(request_reader, data_values, sample_infos, sample_sizes);
-        dds_DataSeq_delete(data_values);
-        dds_SampleInfoSeq_delete(sample_infos);
-        dds_UnsignedLongSeq_delete(sample_sizes);
         return RMW_RET_ERROR;
       }
       uint32_t size = dds_UnsignedLongSeq_get(sample_sizes, 0);
@@ -664,9 +677,6 @@ rmw_take_request(
       if (!res) {
         // Error message already set
         dds_DataReader_raw_return_loan(request_reader, data_values, sample_infos, sample_sizes);
-        dds_DataSeq_delete(data_values);
-        dds_SampleInfoSeq_delete(sample_infos);
-        dds_UnsignedLongSeq_delete(sample_sizes);
         return RMW_RET_ERROR;
       }
 
@@ -680,9 +690,6 @@ rmw_take_request(
     }
 
     dds_DataReader_raw_return_loan(request_reader, data_values, sample_infos, sample_sizes);
-    dds_DataSeq_delete(data_values);
-    dds_SampleInfoSeq_delete(sample_infos);
-    dds_UnsignedLongSeq_delete(sample_sizes);
   } else {
     dds_ReturnCode_t ret = dds_DataReader_raw_take_w_sampleinfoex(
       request_reader, dds_HANDLE_NIL, data_values, sample_infos, sample_sizes, 1,
@@ -690,18 +697,12 @@ rmw_take_request(
 
     if (ret == dds_RETCODE_NO_DATA) {
       dds_DataReader_raw_return_loan(request_reader, data_values, sample_infos, sample_sizes);
-      dds_DataSeq_delete(data_values);
-      dds_SampleInfoSeq_delete(sample_infos);
-      dds_UnsignedLongSeq_delete(sample_sizes);
       return RMW_RET_OK;
     }
 
     if (ret != dds_RETCODE_OK) {
       RMW_SET_ERROR_MSG("failed to take data");
       dds_DataReader_raw_return_loan(request_reader, data_values, sample_infos, sample_sizes);
-      dds_DataSeq_delete(data_values);
-      dds_SampleInfoSeq_delete(sample_infos);
-      dds_UnsignedLongSeq_delete(sample_sizes);
       return RMW_RET_ERROR;
     }
 
@@ -710,9 +711,6 @@ rmw_take_request(
       void * sample = dds_DataSeq_get(data_values, 0);
       if (sample == nullptr) {
         dds_DataReader_raw_return_loan(request_reader, data_values, sample_infos, sample_sizes);
-        dds_DataSeq_delete(data_values);
-        dds_SampleInfoSeq_delete(sample_infos);
-        dds_UnsignedLongSeq_delete(sample_sizes);
         return RMW_RET_ERROR;
       }
       uint32_t size = dds_UnsignedLongSeq_get(sample_sizes, 0);
@@ -733,9 +731,6 @@ rmw_take_request(
       if (!res) {
         // Error message already set
         dds_DataReader_raw_return_loan(request_reader, data_values, sample_infos, sample_sizes);
-        dds_DataSeq_delete(data_values);
-        dds_SampleInfoSeq_delete(sample_infos);
-        dds_UnsignedLongSeq_delete(sample_sizes);
         return RMW_RET_ERROR;
       }
 
@@ -749,9 +744,6 @@ rmw_take_request(
     }
 
     dds_DataReader_raw_return_loan(request_reader, data_values, sample_infos, sample_sizes);
-    dds_DataSeq_delete(data_values);
-    dds_SampleInfoSeq_delete(sample_infos);
-    dds_UnsignedLongSeq_delete(sample_sizes);
   }
 
   *taken = true;
@@ -791,65 +783,42 @@ rmw_send_response(
   }
 
   size_t size = 0;
+  std::unique_lock<std::mutex> buffer_lock(service_info->serialization_mutex, std::try_to_lock);
+  std::vector<uint8_t> temporary_buffer;
+  std::vector<uint8_t> & dds_response =
+    buffer_lock.owns_lock() ? service_info->serialization_buffer : temporary_buffer;
 
   if (service_info->ctx->service_mapping_basic) {
-    void * dds_response = allocate_response_basic(
-      type_support->data,
-      type_support->typesupport_identifier,
-      ros_response,
-      &size
-    );
-
-    if (dds_response == nullptr) {
-      return RMW_RET_ERROR;
-    }
-
     bool res = serialize_response_basic(
       type_support->data,
       type_support->typesupport_identifier,
       ros_response,
       dds_response,
-      size,
+      &size,
       request_header->sequence_number,
       request_header->writer_guid
     );
 
     if (!res) {
       RMW_SET_ERROR_MSG("failed to serialize message");
-      free(dds_response);
       return RMW_RET_ERROR;
     }
 
-    if (dds_DataWriter_raw_write(response_writer, dds_response, size) != dds_RETCODE_OK) {
+    if (dds_DataWriter_raw_write(response_writer, dds_response.data(), size) != dds_RETCODE_OK) {
       RMW_SET_ERROR_MSG("failed to publish data");
-      free(dds_response);
       return RMW_RET_ERROR;
     }
-    free(dds_response);
   } else {
-    void * dds_response = allocate_response_enhanced(
-      type_support->data,
-      type_support->typesupport_identifier,
-      ros_response,
-      &size
-    );
-
-    if (dds_response == nullptr) {
-      // Error message already set
-      return RMW_RET_ERROR;
-    }
-
     bool res = serialize_response_enhanced(
       type_support->data,
       type_support->typesupport_identifier,
       ros_response,
       dds_response,
-      size
+      &size
     );
 
     if (!res) {
       // Error message already set
-      free(dds_response);
       return RMW_RET_ERROR;
     }
 
@@ -861,13 +830,11 @@ rmw_send_response(
       reinterpret_cast<uint8_t *>(&sampleinfo_ex.src_guid));
 
     if (dds_DataWriter_raw_write_w_sampleinfoex(
-        response_writer, dds_response, size, &sampleinfo_ex) != dds_RETCODE_OK)
+        response_writer, dds_response.data(), size, &sampleinfo_ex) != dds_RETCODE_OK)
     {
       RMW_SET_ERROR_MSG("failed to send response");
-      free(dds_response);
       return RMW_RET_ERROR;
     }
-    free(dds_response);
   }
 
   return RMW_RET_OK;
@@ -879,11 +846,19 @@ rmw_service_set_on_new_request_callback(
   rmw_event_callback_t callback,
   const void * user_data)
 {
-  (void)rmw_service;
-  (void)callback;
-  (void)user_data;
+  RMW_CHECK_ARGUMENT_FOR_NULL(rmw_service, RMW_RET_INVALID_ARGUMENT);
+  RMW_CHECK_TYPE_IDENTIFIERS_MATCH(
+    rmw_service,
+    rmw_service->implementation_identifier, RMW_GURUMDDS_ID,
+    return RMW_RET_INCORRECT_RMW_IMPLEMENTATION);
 
-  RMW_SET_ERROR_MSG("rmw_service_set_on_new_request_callback not implemented");
-  return RMW_RET_UNSUPPORTED;
+  GurumddsServiceInfo * service_info = static_cast<GurumddsServiceInfo *>(rmw_service->data);
+  if (service_info == nullptr) {
+    RMW_SET_ERROR_MSG("service info handle is null");
+    return RMW_RET_ERROR;
+  }
+
+  service_info->new_request_callback.set(callback, user_data);
+  return RMW_RET_OK;
 }
 }  // extern "C"
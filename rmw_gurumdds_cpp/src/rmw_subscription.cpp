@@ -12,13 +12,23 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <algorithm>
+#include <array>
+#include <atomic>
 #include <utility>
 #include <string>
 #include <limits>
 #include <thread>
 #include <chrono>
+#include <memory>
+#include <new>
+#include <cstdint>
+#include <functional>
+#include <vector>
 
+#include "rcutils/allocator.h"
 #include "rcutils/error_handling.h"
+#include "rcutils/time.h"
 
 #include "rcpputils/scope_exit.hpp"
 
@@ -37,8 +47,114 @@
 #include "rmw_gurumdds_cpp/qos.hpp"
 #include "rmw_gurumdds_cpp/rmw_context_impl.hpp"
 #include "rmw_gurumdds_cpp/rmw_subscription.hpp"
+#include "rmw_gurumdds_cpp/serialized_loan.hpp"
 #include "rmw_gurumdds_cpp/types.hpp"
 
+// Counts the samples that arrived since the last call. They are only read, so they stay in the
+// reader for rmw_take, and marked read so that a later call does not count them again.
+static size_t
+_count_new_samples(GurumddsSubscriberInfo * subscriber_info)
+{
+  TakeSequencesGuard sequences(subscriber_info->listener_sequences);
+  if (!sequences.is_valid()) {
+    return 0;
+  }
+
+  size_t count = 0;
+  while (true) {
+    dds_ReturnCode_t ret = dds_DataReader_raw_read_w_sampleinfoex(
+      subscriber_info->topic_reader, dds_HANDLE_NIL, sequences.data_values,
+      sequences.sample_infos, sequences.sample_sizes, sequences.length,
+      dds_NOT_READ_SAMPLE_STATE, dds_ANY_VIEW_STATE, dds_ANY_INSTANCE_STATE);
+    uint32_t sample_count = 0;
+    if (ret == dds_RETCODE_OK) {
+      sample_count = dds_SampleInfoSeq_length(sequences.sample_infos);
+      for (uint32_t i = 0; i < sample_count; i++) {
+        if (dds_SampleInfoSeq_get(sequences.sample_infos, i)->valid_data) {
+          count++;
+        }
+      }
+    }
+
+    dds_DataReader_raw_return_loan(
+      subscriber_info->topic_reader, sequences.data_values,
+      sequences.sample_infos, sequences.sample_sizes);
+    if (sample_count < sequences.length) {
+      break;
+    }
+  }
+
+  return count;
+}
+
+static void
+_on_data_available(const dds_DataReader * a_reader)
+{
+  dds_DataReader * reader = const_cast<dds_DataReader *>(a_reader);
+  auto subscriber_info = reinterpret_cast<GurumddsSubscriberInfo *>(
+    dds_Entity_get_context(reinterpret_cast<dds_Entity *>(reader), 0));
+  if (subscriber_info == nullptr) {
+    return;
+  }
+
+  size_t count = _count_new_samples(subscriber_info);
+  if (count > 0) {
+    subscriber_info->new_message_callback.notify(count);
+  }
+}
+
+static void
+_on_subscription_matched(
+  const dds_DataReader * a_reader,
+  const dds_SubscriptionMatchedStatus * status)
+{
+  dds_DataReader * reader = const_cast<dds_DataReader *>(a_reader);
+  auto subscriber_info = reinterpret_cast<GurumddsSubscriberInfo *>(
+    dds_Entity_get_context(reinterpret_cast<dds_Entity *>(reader), 0));
+  if (subscriber_info == nullptr || status == nullptr) {
+    return;
+  }
+
+  subscriber_info->matched_publications.update(status->total_count, status->current_count);
+  subscriber_info->publication_generation++;
+}
+
+// Installs the reader listener. The data available status is only enabled while a new message
+// callback is set, so that samples are not read twice when nobody is notified.
+static dds_ReturnCode_t
+_set_reader_listener(dds_DataReader * topic_reader, bool data_available)
+{
+  dds_DataReaderListener reader_listener;
+  memset(&reader_listener, 0, sizeof(reader_listener));
+  reader_listener.on_data_available = _on_data_available;
+  reader_listener.on_subscription_matched = _on_subscription_matched;
+  dds_StatusMask mask = dds_SUBSCRIPTION_MATCHED_STATUS;
+  if (data_available) {
+    mask |= dds_DATA_AVAILABLE_STATUS;
+  }
+  return dds_DataReader_set_listener(topic_reader, &reader_listener, mask);
+}
+
+// Resolves the introspection type support a subscription works with, or sets an error and
+// returns nullptr
+static const rosidl_message_type_support_t *
+_get_introspection_typesupport(const rosidl_message_type_support_t * type_supports)
+{
+  const rosidl_message_type_support_t * type_support =
+    get_message_typesupport_handle(type_supports, rosidl_typesupport_introspection_c__identifier);
+  if (type_support == nullptr) {
+    rcutils_reset_error();
+    type_support = get_message_typesupport_handle(
+      type_supports, rosidl_typesupport_introspection_cpp::typesupport_identifier);
+    if (type_support == nullptr) {
+      rcutils_reset_error();
+      RMW_SET_ERROR_MSG("type support not from this implementation");
+      return nullptr;
+    }
+  }
+  return type_support;
+}
+
 rmw_subscription_t *
 __rmw_create_subscription(
   rmw_context_impl_t * const ctx,
@@ -54,16 +170,10 @@ __rmw_create_subscription(
   std::lock_guard<std::mutex> guard(ctx->endpoint_mutex);
 
   const rosidl_message_type_support_t * type_support =
-    get_message_typesupport_handle(type_supports, rosidl_typesupport_introspection_c__identifier);
+    _get_introspection_typesupport(type_supports);
   if (type_support == nullptr) {
-    rcutils_reset_error();
-    type_support = get_message_typesupport_handle(
-      type_supports, rosidl_typesupport_introspection_cpp::typesupport_identifier);
-    if (type_support == nullptr) {
-      rcutils_reset_error();
-      RMW_SET_ERROR_MSG("type support not from this implementation");
-      return nullptr;
-    }
+    // Error message already set
+    return nullptr;
   }
 
   rmw_subscription_t * rmw_subscription = nullptr;
@@ -164,17 +274,59 @@ __rmw_create_subscription(
     return nullptr;
   }
 
+  std::shared_ptr<SerializationPlan> serialization_plan =
+    create_serialization_plan(type_support->data, type_support->typesupport_identifier);
+  if (serialization_plan == nullptr) {
+    // Error message already set
+    return nullptr;
+  }
+
   subscriber_info = new(std::nothrow) GurumddsSubscriberInfo();
   if (subscriber_info == nullptr) {
     RMW_SET_ERROR_MSG("failed to allocate GurumddsSubscriberInfo");
     return nullptr;
   }
 
+  if (!subscriber_info->take_sequences.init(1) ||
+    !subscriber_info->listener_sequences.init(RMW_GURUMDDS_LISTENER_READ_LENGTH))
+  {
+    RMW_SET_ERROR_MSG("failed to create take sequences");
+    delete subscriber_info;
+    return nullptr;
+  }
+
+  if (!subscriber_info->matched_publications.init()) {
+    RMW_SET_ERROR_MSG("failed to create guard condition");
+    delete subscriber_info;
+    return nullptr;
+  }
+
   subscriber_info->topic_reader = topic_reader;
   subscriber_info->read_condition = read_condition;
   subscriber_info->rosidl_message_typesupport = type_support;
   subscriber_info->implementation_identifier = RMW_GURUMDDS_ID;
   subscriber_info->ctx = ctx;
+  subscriber_info->serialization_plan = serialization_plan;
+  if (serialization_plan->is_fixed_size()) {
+    subscriber_info->loan_pool.init(serialization_plan->get_message_size());
+  }
+
+  dds_Entity_set_context(
+    reinterpret_cast<dds_Entity *>(topic_reader), 0, reinterpret_cast<void *>(subscriber_info));
+  ret = _set_reader_listener(topic_reader, false);
+  if (ret != dds_RETCODE_OK) {
+    RMW_SET_ERROR_MSG("failed to set datareader listener");
+    delete subscriber_info;
+    return nullptr;
+  }
+
+  {
+    // Matches made before the listener was set
+    dds_SubscriptionMatchedStatus status;
+    if (dds_DataReader_get_subscription_matched_status(topic_reader, &status) == dds_RETCODE_OK) {
+      subscriber_info->matched_publications.update(status.total_count, status.current_count);
+    }
+  }
 
   entity_get_gid(
     reinterpret_cast<dds_Entity *>(subscriber_info->topic_reader),
@@ -208,7 +360,9 @@ __rmw_create_subscription(
     topic_name,
     strlen(topic_name) + 1);
   rmw_subscription->options = *subscription_options;
-  rmw_subscription->can_loan_messages = false;
+  // As for publishers, only fixed-size messages are lent, since a pooled message of any other
+  // type would have its strings and sequences built and torn down on every take
+  rmw_subscription->can_loan_messages = serialization_plan->is_fixed_size();
   rmw_subscription->is_cft_enabled = false;
 
   if (!internal) {
@@ -243,6 +397,21 @@ __rmw_destroy_subscription(
     dds_Topic * topic =
       reinterpret_cast<dds_Topic *>(dds_DataReader_get_topicdescription(
         subscriber_info->topic_reader));
+    wait_sets_forget_condition(reinterpret_cast<dds_Condition *>(subscriber_info->read_condition));
+    wait_sets_forget_condition(
+      reinterpret_cast<dds_Condition *>(
+        dds_DataReader_get_statuscondition(subscriber_info->topic_reader)));
+    dds_DataReader_set_listener(subscriber_info->topic_reader, nullptr, 0);
+    {
+      // Loans still held by the user cannot outlive the DataReader
+      std::lock_guard<std::mutex> lock(subscriber_info->raw_loans_mutex);
+      for (auto & loan : subscriber_info->raw_loans) {
+        dds_DataReader_raw_return_loan(
+          subscriber_info->topic_reader,
+          loan.second->data_values, loan.second->sample_infos, loan.second->sample_sizes);
+      }
+      subscriber_info->raw_loans.clear();
+    }
     ret = dds_Subscriber_delete_datareader(ctx->subscriber, subscriber_info->topic_reader);
     if (ret != dds_RETCODE_OK) {
       RMW_SET_ERROR_MSG("failed to delete datareader");
@@ -264,6 +433,98 @@ __rmw_destroy_subscription(
   return RMW_RET_OK;
 }
 
+static rmw_ret_t
+_get_take_sequences(
+  GurumddsSubscriberInfo * subscriber_info,
+  rmw_subscription_allocation_t * allocation,
+  GurumddsTakeSequences ** take_sequences)
+{
+  if (allocation == nullptr) {
+    *take_sequences = &subscriber_info->take_sequences;
+    return RMW_RET_OK;
+  }
+
+  RMW_CHECK_TYPE_IDENTIFIERS_MATCH(
+    allocation,
+    allocation->implementation_identifier,
+    RMW_GURUMDDS_ID,
+    return RMW_RET_INCORRECT_RMW_IMPLEMENTATION);
+
+  auto allocation_info = static_cast<GurumddsSubscriptionAllocation *>(allocation->data);
+  RCUTILS_CHECK_ARGUMENT_FOR_NULL(allocation_info, RMW_RET_ERROR);
+
+  if (allocation_info->type_support != subscriber_info->rosidl_message_typesupport) {
+    RMW_SET_ERROR_MSG("allocation was initialized for a different message type");
+    return RMW_RET_INVALID_ARGUMENT;
+  }
+
+  *take_sequences = &allocation_info->take_sequences;
+  return RMW_RET_OK;
+}
+
+// Publisher GIDs never change for a publication handle, so DDS is only asked once per handle
+// until a publication matches or goes away.
+static void
+_get_publisher_gid(
+  GurumddsSubscriberInfo * info,
+  dds_InstanceHandle_t publication_handle,
+  uint8_t * gid)
+{
+  uint64_t generation = info->publication_generation.load();
+  std::lock_guard<std::mutex> guard(info->publisher_gids_mutex);
+  if (info->publisher_gids_generation != generation) {
+    info->publisher_gids.clear();
+    info->publisher_gids_generation = generation;
+  }
+
+  auto it = info->publisher_gids.find(publication_handle);
+  if (it != info->publisher_gids.end()) {
+    memcpy(gid, it->second.data(), RMW_GID_STORAGE_SIZE);
+    return;
+  }
+
+  memset(gid, 0, RMW_GID_STORAGE_SIZE);
+  dds_ReturnCode_t ret = dds_DataReader_get_guid_from_publication_handle(
+    info->topic_reader, publication_handle, gid);
+  if (ret != dds_RETCODE_OK) {
+    if (ret == dds_RETCODE_ERROR) {
+      RCUTILS_LOG_WARN_NAMED(RMW_GURUMDDS_ID, "Failed to get publication handle");
+    }
+    memset(gid, 0, RMW_GID_STORAGE_SIZE);
+    return;
+  }
+
+  std::array<uint8_t, RMW_GID_STORAGE_SIZE> & cached = info->publisher_gids[publication_handle];
+  memcpy(cached.data(), gid, RMW_GID_STORAGE_SIZE);
+}
+
+static void
+_fill_message_info(
+  const char * identifier,
+  GurumddsSubscriberInfo * info,
+  dds_SampleInfo * sample_info,
+  int64_t reception_sequence_number,
+  rmw_message_info_t * message_info)
+{
+  int64_t sequence_number = 0;
+  dds_SampleInfoEx * sampleinfo_ex = reinterpret_cast<dds_SampleInfoEx *>(sample_info);
+  dds_sn_to_ros_sn(sampleinfo_ex->seq, &sequence_number);
+  message_info->source_timestamp =
+    sample_info->source_timestamp.sec * static_cast<int64_t>(1000000000) +
+    sample_info->source_timestamp.nanosec;
+  // SampleInfo doesn't contain the reception time, the sample is stamped when it is taken
+  rcutils_time_point_value_t received_timestamp = 0;
+  if (rcutils_system_time_now(&received_timestamp) != RCUTILS_RET_OK) {
+    received_timestamp = 0;
+  }
+  message_info->received_timestamp = received_timestamp;
+  message_info->publication_sequence_number = sequence_number;
+  message_info->reception_sequence_number = reception_sequence_number;
+  rmw_gid_t * sender_gid = &message_info->publisher_gid;
+  sender_gid->implementation_identifier = identifier;
+  _get_publisher_gid(info, sample_info->publication_handle, sender_gid->data);
+}
+
 static rmw_ret_t
 _take(
   const char * identifier,
@@ -273,7 +534,6 @@ _take(
   rmw_message_info_t * message_info,
   rmw_subscription_allocation_t * allocation)
 {
-  (void)allocation;
   *taken = false;
 
   RMW_CHECK_TYPE_IDENTIFIERS_MATCH(
@@ -288,26 +548,20 @@ _take(
   dds_DataReader * topic_reader = subscriber_info->topic_reader;
   RCUTILS_CHECK_ARGUMENT_FOR_NULL(topic_reader, RMW_RET_ERROR);
 
-  dds_DataSeq * data_values = dds_DataSeq_create(1);
-  if (data_values == nullptr) {
-    RMW_SET_ERROR_MSG("failed to create data sequence");
-    return RMW_RET_ERROR;
+  GurumddsTakeSequences * take_sequences = nullptr;
+  rmw_ret_t rmw_ret = _get_take_sequences(subscriber_info, allocation, &take_sequences);
+  if (rmw_ret != RMW_RET_OK) {
+    return rmw_ret;
   }
 
-  dds_SampleInfoSeq * sample_infos = dds_SampleInfoSeq_create(1);
-  if (sample_infos == nullptr) {
-    RMW_SET_ERROR_MSG("failed to create sample info sequence");
-    dds_DataSeq_delete(data_values);
-    return RMW_RET_ERROR;
-  }
-
-  dds_UnsignedLongSeq * sample_sizes = dds_UnsignedLongSeq_create(1);
-  if (sample_sizes == nullptr) {
-    RMW_SET_ERROR_MSG("failed to create sample size sequence");
-    dds_DataSeq_delete(data_values);
-    dds_SampleInfoSeq_delete(sample_infos);
+  TakeSequencesGuard sequences(*take_sequences);
+  if (!sequences.is_valid()) {
+    RMW_SET_ERROR_MSG("failed to create take sequences");
     return RMW_RET_ERROR;
   }
+  dds_DataSeq * data_values = sequences.data_values;
+  dds_SampleInfoSeq * sample_infos = sequences.sample_infos;
+  dds_UnsignedLongSeq * sample_sizes = sequences.sample_sizes;
 
   dds_ReturnCode_t ret = dds_DataReader_raw_take_w_sampleinfoex(
     topic_reader, dds_HANDLE_NIL, data_values, sample_infos, sample_sizes, 1,
@@ -317,18 +571,12 @@ _take(
     RCUTILS_LOG_DEBUG_NAMED(
       RMW_GURUMDDS_ID, "No data on topic %s", subscription->topic_name);
     dds_DataReader_raw_return_loan(topic_reader, data_values, sample_infos, sample_sizes);
-    dds_DataSeq_delete(data_values);
-    dds_SampleInfoSeq_delete(sample_infos);
-    dds_UnsignedLongSeq_delete(sample_sizes);
     return RMW_RET_OK;
   }
 
   if (ret != dds_RETCODE_OK) {
     RMW_SET_ERROR_MSG("failed to take data");
     dds_DataReader_raw_return_loan(topic_reader, data_values, sample_infos, sample_sizes);
-    dds_DataSeq_delete(data_values);
-    dds_SampleInfoSeq_delete(sample_infos);
-    dds_UnsignedLongSeq_delete(sample_sizes);
     return RMW_RET_ERROR;
   }
 
@@ -342,9 +590,6 @@ _take(
     if (sample == nullptr) {
       RMW_SET_ERROR_MSG("failed to get message");
       dds_DataReader_raw_return_loan(topic_reader, data_values, sample_infos, sample_sizes);
-      dds_DataSeq_delete(data_values);
-      dds_SampleInfoSeq_delete(sample_infos);
-      dds_UnsignedLongSeq_delete(sample_sizes);
       return RMW_RET_ERROR;
     }
     uint32_t sample_size = dds_UnsignedLongSeq_get(sample_sizes, 0);
@@ -353,48 +598,25 @@ _take(
       subscriber_info->rosidl_message_typesupport->typesupport_identifier,
       ros_message,
       sample,
-      static_cast<size_t>(sample_size)
+      static_cast<size_t>(sample_size),
+      subscriber_info->serialization_plan.get()
     );
     if (!result) {
       RMW_SET_ERROR_MSG("failed to deserialize message");
       dds_DataReader_raw_return_loan(topic_reader, data_values, sample_infos, sample_sizes);
-      dds_DataSeq_delete(data_values);
-      dds_SampleInfoSeq_delete(sample_infos);
-      dds_UnsignedLongSeq_delete(sample_sizes);
       return RMW_RET_ERROR;
     }
 
     *taken = true;
 
+    int64_t reception_sequence_number = ++subscriber_info->reception_sequence_number;
     if (message_info != nullptr) {
-      int64_t sequence_number = 0;
-      dds_SampleInfoEx * sampleinfo_ex = reinterpret_cast<dds_SampleInfoEx *>(sample_info);
-      dds_sn_to_ros_sn(sampleinfo_ex->seq, &sequence_number);
-      message_info->source_timestamp =
-        sample_info->source_timestamp.sec * static_cast<int64_t>(1000000000) +
-        sample_info->source_timestamp.nanosec;
-      // TODO(clemjh): SampleInfo doesn't contain received_timestamp
-      message_info->received_timestamp = 0;
-      message_info->publication_sequence_number = sequence_number;
-      message_info->reception_sequence_number = RMW_MESSAGE_INFO_SEQUENCE_NUMBER_UNSUPPORTED;
-      rmw_gid_t * sender_gid = &message_info->publisher_gid;
-      sender_gid->implementation_identifier = identifier;
-      memset(sender_gid->data, 0, RMW_GID_STORAGE_SIZE);
-      dds_ReturnCode_t ret = dds_DataReader_get_guid_from_publication_handle(
-        topic_reader, sample_info->publication_handle, sender_gid->data);
-      if (ret != dds_RETCODE_OK) {
-        if (ret == dds_RETCODE_ERROR) {
-          RCUTILS_LOG_WARN_NAMED(RMW_GURUMDDS_ID, "Failed to get publication handle");
-        }
-        memset(sender_gid->data, 0, RMW_GID_STORAGE_SIZE);
-      }
+      _fill_message_info(
+        identifier, subscriber_info, sample_info, reception_sequence_number, message_info);
     }
   }
 
   dds_DataReader_raw_return_loan(topic_reader, data_values, sample_infos, sample_sizes);
-  dds_DataSeq_delete(data_values);
-  dds_SampleInfoSeq_delete(sample_infos);
-  dds_UnsignedLongSeq_delete(sample_sizes);
 
   return RMW_RET_OK;
 }
@@ -408,7 +630,6 @@ _take_serialized(
   rmw_message_info_t * message_info,
   rmw_subscription_allocation_t * allocation)
 {
-  (void)allocation;
   *taken = false;
 
   RMW_CHECK_TYPE_IDENTIFIERS_MATCH(
@@ -423,26 +644,20 @@ _take_serialized(
   dds_DataReader * topic_reader = subscriber_info->topic_reader;
   RCUTILS_CHECK_ARGUMENT_FOR_NULL(topic_reader, RMW_RET_ERROR);
 
-  dds_DataSeq * data_values = dds_DataSeq_create(1);
-  if (data_values == nullptr) {
-    RMW_SET_ERROR_MSG("failed to create data sequence");
-    return RMW_RET_ERROR;
-  }
-
-  dds_SampleInfoSeq * sample_infos = dds_SampleInfoSeq_create(1);
-  if (sample_infos == nullptr) {
-    RMW_SET_ERROR_MSG("failed to create sample info sequence");
-    dds_DataSeq_delete(data_values);
-    return RMW_RET_ERROR;
+  GurumddsTakeSequences * take_sequences = nullptr;
+  rmw_ret_t rmw_ret = _get_take_sequences(subscriber_info, allocation, &take_sequences);
+  if (rmw_ret != RMW_RET_OK) {
+    return rmw_ret;
   }
 
-  dds_UnsignedLongSeq * sample_sizes = dds_UnsignedLongSeq_create(1);
-  if (sample_sizes == nullptr) {
-    RMW_SET_ERROR_MSG("failed to create sample size sequence");
-    dds_DataSeq_delete(data_values);
-    dds_SampleInfoSeq_delete(sample_infos);
+  TakeSequencesGuard sequences(*take_sequences);
+  if (!sequences.is_valid()) {
+    RMW_SET_ERROR_MSG("failed to create take sequences");
     return RMW_RET_ERROR;
   }
+  dds_DataSeq * data_values = sequences.data_values;
+  dds_SampleInfoSeq * sample_infos = sequences.sample_infos;
+  dds_UnsignedLongSeq * sample_sizes = sequences.sample_sizes;
 
   dds_ReturnCode_t ret = dds_DataReader_raw_take_w_sampleinfoex(
     topic_reader, dds_HANDLE_NIL, data_values, sample_infos, sample_sizes, 1,
@@ -452,18 +667,12 @@ _take_serialized(
     RCUTILS_LOG_DEBUG_NAMED(
       RMW_GURUMDDS_ID, "No data on topic %s", subscription->topic_name);
     dds_DataReader_raw_return_loan(topic_reader, data_values, sample_infos, sample_sizes);
-    dds_DataSeq_delete(data_values);
-    dds_SampleInfoSeq_delete(sample_infos);
-    dds_UnsignedLongSeq_delete(sample_sizes);
     return RMW_RET_OK;
   }
 
   if (ret != dds_RETCODE_OK) {
     RMW_SET_ERROR_MSG("failed to take data");
     dds_DataReader_raw_return_loan(topic_reader, data_values, sample_infos, sample_sizes);
-    dds_DataSeq_delete(data_values);
-    dds_SampleInfoSeq_delete(sample_infos);
-    dds_UnsignedLongSeq_delete(sample_sizes);
     return RMW_RET_ERROR;
   }
 
@@ -477,22 +686,21 @@ _take_serialized(
     if (sample == nullptr) {
       RMW_SET_ERROR_MSG("failed to take data");
       dds_DataReader_raw_return_loan(topic_reader, data_values, sample_infos, sample_sizes);
-      dds_DataSeq_delete(data_values);
-      dds_SampleInfoSeq_delete(sample_infos);
-      dds_UnsignedLongSeq_delete(sample_sizes);
       return RMW_RET_ERROR;
     }
 
     uint32_t sample_size = dds_UnsignedLongSeq_get(sample_sizes, 0);
     serialized_message->buffer_length = sample_size;
     if (serialized_message->buffer_capacity < sample_size) {
-      rmw_ret_t rmw_ret = rmw_serialized_message_resize(serialized_message, sample_size);
+      // Small bounded types grow the buffer once to their largest size
+      size_t capacity = std::max<size_t>(
+        sample_size,
+        std::min<size_t>(
+          subscriber_info->serialization_plan->get_max_serialized_size(), CDR_MAX_PRESIZE));
+      rmw_ret = rmw_serialized_message_resize(serialized_message, capacity);
       if (rmw_ret != RMW_RET_OK) {
         // Error message already set
         dds_DataReader_raw_return_loan(topic_reader, data_values, sample_infos, sample_sizes);
-        dds_DataSeq_delete(data_values);
-        dds_SampleInfoSeq_delete(sample_infos);
-        dds_UnsignedLongSeq_delete(sample_sizes);
         return rmw_ret;
       }
     }
@@ -501,39 +709,250 @@ _take_serialized(
 
     *taken = true;
 
+    int64_t reception_sequence_number = ++subscriber_info->reception_sequence_number;
     if (message_info != nullptr) {
-      int64_t sequence_number = 0;
-      dds_SampleInfoEx * sampleinfo_ex = reinterpret_cast<dds_SampleInfoEx *>(sample_info);
-      dds_sn_to_ros_sn(sampleinfo_ex->seq, &sequence_number);
-      message_info->source_timestamp =
-        sample_info->source_timestamp.sec * static_cast<int64_t>(1000000000) +
-        sample_info->source_timestamp.nanosec;
-      // TODO(clemjh): SampleInfo doesn't contain received_timestamp
-      message_info->received_timestamp = 0;
-      message_info->publication_sequence_number = sequence_number;
-      message_info->reception_sequence_number = RMW_MESSAGE_INFO_SEQUENCE_NUMBER_UNSUPPORTED;
-      rmw_gid_t * sender_gid = &message_info->publisher_gid;
-      sender_gid->implementation_identifier = identifier;
-      memset(sender_gid->data, 0, RMW_GID_STORAGE_SIZE);
-      dds_ReturnCode_t ret = dds_DataReader_get_guid_from_publication_handle(
-        topic_reader, sample_info->publication_handle, sender_gid->data);
-      if (ret != dds_RETCODE_OK) {
-        if (ret == dds_RETCODE_ERROR) {
-          RCUTILS_LOG_WARN_NAMED(RMW_GURUMDDS_ID, "Failed to get publication handle");
-        }
-        memset(sender_gid->data, 0, RMW_GID_STORAGE_SIZE);
-      }
+      _fill_message_info(
+        identifier, subscriber_info, sample_info, reception_sequence_number, message_info);
+    }
+  }
+
+  dds_DataReader_raw_return_loan(topic_reader, data_values, sample_infos, sample_sizes);
+
+  return RMW_RET_OK;
+}
+
+static std::unique_ptr<GurumddsTakeSequences>
+_acquire_raw_loan_sequences(GurumddsSubscriberInfo * subscriber_info)
+{
+  {
+    std::lock_guard<std::mutex> lock(subscriber_info->raw_loans_mutex);
+    if (!subscriber_info->free_raw_loan_sequences.empty()) {
+      std::unique_ptr<GurumddsTakeSequences> sequences =
+        std::move(subscriber_info->free_raw_loan_sequences.back());
+      subscriber_info->free_raw_loan_sequences.pop_back();
+      return sequences;
+    }
+  }
+
+  std::unique_ptr<GurumddsTakeSequences> sequences(new(std::nothrow) GurumddsTakeSequences());
+  if (sequences == nullptr || !sequences->init(1)) {
+    return nullptr;
+  }
+  return sequences;
+}
+
+static void
+_release_raw_loan_sequences(
+  GurumddsSubscriberInfo * subscriber_info,
+  std::unique_ptr<GurumddsTakeSequences> sequences)
+{
+  if (sequences->length != 1) {
+    // Only single sample sequences are reused, batches are sized per take
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock(subscriber_info->raw_loans_mutex);
+  try {
+    subscriber_info->free_raw_loan_sequences.push_back(std::move(sequences));
+  } catch (std::bad_alloc &) {
+    // Dropped sequences are deleted with the unique_ptr
+  }
+}
+
+static rmw_ret_t
+_take_loaned(
+  const rmw_subscription_t * subscription,
+  void ** loaned_message,
+  bool * taken,
+  rmw_message_info_t * message_info,
+  rmw_subscription_allocation_t * allocation)
+{
+  (void)allocation;
+  RMW_CHECK_ARGUMENT_FOR_NULL(subscription, RMW_RET_INVALID_ARGUMENT);
+  RMW_CHECK_ARGUMENT_FOR_NULL(loaned_message, RMW_RET_INVALID_ARGUMENT);
+  RMW_CHECK_ARGUMENT_FOR_NULL(taken, RMW_RET_INVALID_ARGUMENT);
+  RMW_CHECK_TYPE_IDENTIFIERS_MATCH(
+    subscription,
+    subscription->implementation_identifier,
+    RMW_GURUMDDS_ID,
+    return RMW_RET_INCORRECT_RMW_IMPLEMENTATION);
+
+  if (!subscription->can_loan_messages) {
+    RMW_SET_ERROR_MSG("Loaning is not supported");
+    return RMW_RET_UNSUPPORTED;
+  }
+
+  *taken = false;
+
+  auto subscriber_info = static_cast<GurumddsSubscriberInfo *>(subscription->data);
+  RCUTILS_CHECK_ARGUMENT_FOR_NULL(subscriber_info, RMW_RET_ERROR);
+
+  dds_DataReader * topic_reader = subscriber_info->topic_reader;
+  RCUTILS_CHECK_ARGUMENT_FOR_NULL(topic_reader, RMW_RET_ERROR);
+
+  // Each take gets its own sequences, since a sample lent in place holds them until returned
+  std::unique_ptr<GurumddsTakeSequences> sequences = _acquire_raw_loan_sequences(subscriber_info);
+  if (sequences == nullptr) {
+    RMW_SET_ERROR_MSG("failed to create take sequences");
+    return RMW_RET_ERROR;
+  }
+  dds_DataSeq * data_values = sequences->data_values;
+  dds_SampleInfoSeq * sample_infos = sequences->sample_infos;
+  dds_UnsignedLongSeq * sample_sizes = sequences->sample_sizes;
+
+  dds_ReturnCode_t ret = dds_DataReader_raw_take_w_sampleinfoex(
+    topic_reader, dds_HANDLE_NIL, data_values, sample_infos, sample_sizes, 1,
+    dds_ANY_SAMPLE_STATE, dds_ANY_VIEW_STATE, dds_ANY_INSTANCE_STATE);
+
+  if (ret == dds_RETCODE_NO_DATA) {
+    RCUTILS_LOG_DEBUG_NAMED(
+      RMW_GURUMDDS_ID, "No data on topic %s", subscription->topic_name);
+    dds_DataReader_raw_return_loan(topic_reader, data_values, sample_infos, sample_sizes);
+    _release_raw_loan_sequences(subscriber_info, std::move(sequences));
+    return RMW_RET_OK;
+  }
+
+  if (ret != dds_RETCODE_OK) {
+    RMW_SET_ERROR_MSG("failed to take data");
+    dds_DataReader_raw_return_loan(topic_reader, data_values, sample_infos, sample_sizes);
+    _release_raw_loan_sequences(subscriber_info, std::move(sequences));
+    return RMW_RET_ERROR;
+  }
+
+  RCUTILS_LOG_DEBUG_NAMED(
+    RMW_GURUMDDS_ID, "Received data on topic %s", subscription->topic_name);
+
+  dds_SampleInfo * sample_info = dds_SampleInfoSeq_get(sample_infos, 0);
+  if (!sample_info->valid_data) {
+    dds_DataReader_raw_return_loan(topic_reader, data_values, sample_infos, sample_sizes);
+    _release_raw_loan_sequences(subscriber_info, std::move(sequences));
+    return RMW_RET_OK;
+  }
+
+  uint8_t * sample = static_cast<uint8_t *>(dds_DataSeq_get(data_values, 0));
+  if (sample == nullptr) {
+    RMW_SET_ERROR_MSG("failed to get message");
+    dds_DataReader_raw_return_loan(topic_reader, data_values, sample_infos, sample_sizes);
+    _release_raw_loan_sequences(subscriber_info, std::move(sequences));
+    return RMW_RET_ERROR;
+  }
+  size_t sample_size = static_cast<size_t>(dds_UnsignedLongSeq_get(sample_sizes, 0));
+
+  const SerializationPlan & plan = *subscriber_info->serialization_plan;
+  uint8_t * payload = sample + CDR_HEADER_SIZE;
+
+  // A plain message in host byte order is its own CDR payload, so it is lent in place
+  // when the payload is aligned for the type and covers the whole in-memory message.
+  if (plan.get_plain_size() > 0 &&
+    sample_size >= CDR_HEADER_SIZE + plan.get_message_size() &&
+    sample[CDR_HEADER_ENDIAN_IDX] == system_endian &&
+    reinterpret_cast<uintptr_t>(payload) % plan.get_plain_alignment() == 0)
+  {
+    std::lock_guard<std::mutex> lock(subscriber_info->raw_loans_mutex);
+    try {
+      subscriber_info->raw_loans.emplace(payload, std::move(sequences));
+    } catch (std::bad_alloc &) {
+      RMW_SET_ERROR_MSG("failed to record loaned message");
+      dds_DataReader_raw_return_loan(topic_reader, data_values, sample_infos, sample_sizes);
+      return RMW_RET_BAD_ALLOC;
+    }
+    int64_t reception_sequence_number = ++subscriber_info->reception_sequence_number;
+    if (message_info != nullptr) {
+      _fill_message_info(
+        RMW_GURUMDDS_ID, subscriber_info, sample_info, reception_sequence_number, message_info);
     }
+    *loaned_message = payload;
+    *taken = true;
+    return RMW_RET_OK;
   }
 
+  void * message = subscriber_info->loan_pool.acquire();
+  if (message == nullptr) {
+    RMW_SET_ERROR_MSG("failed to allocate loaned message");
+    dds_DataReader_raw_return_loan(topic_reader, data_values, sample_infos, sample_sizes);
+    _release_raw_loan_sequences(subscriber_info, std::move(sequences));
+    return RMW_RET_BAD_ALLOC;
+  }
+  plan.init_message(message);
+
+  bool result = deserialize_cdr_to_ros(
+    subscriber_info->rosidl_message_typesupport->data,
+    subscriber_info->rosidl_message_typesupport->typesupport_identifier,
+    message,
+    sample,
+    sample_size,
+    subscriber_info->serialization_plan.get()
+  );
+  if (result) {
+    int64_t reception_sequence_number = ++subscriber_info->reception_sequence_number;
+    if (message_info != nullptr) {
+      _fill_message_info(
+        RMW_GURUMDDS_ID, subscriber_info, sample_info, reception_sequence_number, message_info);
+    }
+  }
   dds_DataReader_raw_return_loan(topic_reader, data_values, sample_infos, sample_sizes);
-  dds_DataSeq_delete(data_values);
-  dds_SampleInfoSeq_delete(sample_infos);
-  dds_UnsignedLongSeq_delete(sample_sizes);
+  _release_raw_loan_sequences(subscriber_info, std::move(sequences));
+
+  if (!result) {
+    RMW_SET_ERROR_MSG("failed to deserialize message");
+    plan.fini_message(message);
+    subscriber_info->loan_pool.release(message);
+    return RMW_RET_ERROR;
+  }
 
+  *loaned_message = message;
+  *taken = true;
   return RMW_RET_OK;
 }
 
+// Deserializes a batch of samples, spreading it over up to thread_count threads of the
+// context's pool. Each task works on a contiguous range, so every message is written by
+// exactly one of them.
+static bool
+_deserialize_batch(
+  GurumddsSubscriberInfo * info,
+  const std::vector<GurumddsTakenSample> & samples,
+  size_t thread_count)
+{
+  const void * untyped_members = info->rosidl_message_typesupport->data;
+  const char * typesupport_identifier = info->rosidl_message_typesupport->typesupport_identifier;
+  SerializationPlan * plan = info->serialization_plan.get();
+  std::atomic<bool> result(true);
+
+  auto deserialize_range = [&](size_t begin, size_t end) {
+      for (size_t i = begin; i < end && result.load(std::memory_order_relaxed); i++) {
+        if (!deserialize_cdr_to_ros(
+            untyped_members, typesupport_identifier, samples[i].ros_message,
+            samples[i].sample, samples[i].sample_size, plan))
+        {
+          result.store(false, std::memory_order_relaxed);
+        }
+      }
+    };
+
+  thread_count = std::max<size_t>(1, std::min(thread_count, samples.size()));
+  if (thread_count == 1) {
+    deserialize_range(0, samples.size());
+    return result.load();
+  }
+
+  std::vector<std::function<void()>> tasks;
+  const size_t chunk = (samples.size() + thread_count - 1) / thread_count;
+  try {
+    tasks.reserve(thread_count);
+    for (size_t begin = 0; begin < samples.size(); begin += chunk) {
+      size_t end = std::min(begin + chunk, samples.size());
+      tasks.emplace_back([&deserialize_range, begin, end]() {deserialize_range(begin, end);});
+    }
+  } catch (std::bad_alloc &) {
+    deserialize_range(0, samples.size());
+    return result.load();
+  }
+
+  info->ctx->take_sequence_pool.run(tasks, thread_count);
+  return result.load();
+}
+
 extern "C"
 {
 rmw_ret_t
@@ -542,21 +961,53 @@ rmw_init_subscription_allocation(
   const rosidl_runtime_c__Sequence__bound * message_bounds,
   rmw_subscription_allocation_t * allocation)
 {
-  (void)type_support;
   (void)message_bounds;
-  (void)allocation;
+  RMW_CHECK_ARGUMENT_FOR_NULL(type_support, RMW_RET_INVALID_ARGUMENT);
+  RMW_CHECK_ARGUMENT_FOR_NULL(allocation, RMW_RET_INVALID_ARGUMENT);
 
-  RMW_SET_ERROR_MSG("rmw_init_subscription_allocation is not supported");
-  return RMW_RET_UNSUPPORTED;
+  const rosidl_message_type_support_t * introspection_type_support =
+    _get_introspection_typesupport(type_support);
+  if (introspection_type_support == nullptr) {
+    // Error message already set
+    return RMW_RET_ERROR;
+  }
+
+  // Samples are deserialized straight from the DDS loan, so the take sequences are all
+  // a take needs besides the message itself
+  auto allocation_info = new(std::nothrow) GurumddsSubscriptionAllocation();
+  if (allocation_info == nullptr) {
+    RMW_SET_ERROR_MSG("failed to allocate GurumddsSubscriptionAllocation");
+    return RMW_RET_BAD_ALLOC;
+  }
+
+  if (!allocation_info->take_sequences.init(1)) {
+    RMW_SET_ERROR_MSG("failed to create take sequences");
+    delete allocation_info;
+    return RMW_RET_ERROR;
+  }
+  allocation_info->type_support = introspection_type_support;
+
+  allocation->implementation_identifier = RMW_GURUMDDS_ID;
+  allocation->data = allocation_info;
+
+  return RMW_RET_OK;
 }
 
 rmw_ret_t
 rmw_fini_subscription_allocation(rmw_subscription_allocation_t * allocation)
 {
-  (void)allocation;
+  RMW_CHECK_ARGUMENT_FOR_NULL(allocation, RMW_RET_INVALID_ARGUMENT);
+  RMW_CHECK_TYPE_IDENTIFIERS_MATCH(
+    allocation,
+    allocation->implementation_identifier,
+    RMW_GURUMDDS_ID,
+    return RMW_RET_INCORRECT_RMW_IMPLEMENTATION);
 
-  RMW_SET_ERROR_MSG("rmw_fini_subscription_allocation is not supported");
-  return RMW_RET_UNSUPPORTED;
+  delete static_cast<GurumddsSubscriptionAllocation *>(allocation->data);
+  allocation->implementation_identifier = nullptr;
+  allocation->data = nullptr;
+
+  return RMW_RET_OK;
 }
 
 rmw_subscription_t *
@@ -656,16 +1107,8 @@ rmw_subscription_count_matched_publishers(
     return RMW_RET_ERROR;
   }
 
-  dds_InstanceHandleSeq * seq = dds_InstanceHandleSeq_create(4);
-  if (dds_DataReader_get_matched_publications(topic_reader, seq) != dds_RETCODE_OK) {
-    RMW_SET_ERROR_MSG("failed to get matched publications");
-    dds_InstanceHandleSeq_delete(seq);
-    return RMW_RET_ERROR;
-  }
-
-  *publisher_count = static_cast<size_t>(dds_InstanceHandleSeq_length(seq));
-
-  dds_InstanceHandleSeq_delete(seq);
+  // Kept by the subscription matched listener
+  *publisher_count = static_cast<size_t>(subscriber_info->matched_publications.current_count());
 
   return RMW_RET_OK;
 }
@@ -810,7 +1253,6 @@ rmw_take_sequence(
   size_t * taken,
   rmw_subscription_allocation_t * allocation)
 {
-  (void)allocation;
   RCUTILS_CHECK_FOR_NULL_WITH_MSG(
     subscription, "subscription handle is null", return RMW_RET_INVALID_ARGUMENT);
   RCUTILS_CHECK_FOR_NULL_WITH_MSG(
@@ -853,114 +1295,112 @@ rmw_take_sequence(
   dds_DataReader * topic_reader = info->topic_reader;
   RCUTILS_CHECK_FOR_NULL_WITH_MSG(topic_reader, "topic reader is null", return RMW_RET_ERROR);
 
-  dds_DataSeq * data_values = dds_DataSeq_create(count);
-  if (data_values == nullptr) {
-    RMW_SET_ERROR_MSG("failed to create data sequence");
-    return RMW_RET_ERROR;
+  if (count > std::numeric_limits<uint32_t>::max()) {
+    RMW_SET_ERROR_MSG("count cannot be larger than UINT32_MAX");
+    return RMW_RET_INVALID_ARGUMENT;
   }
 
-  dds_SampleInfoSeq * sample_infos = dds_SampleInfoSeq_create(count);
-  if (sample_infos == nullptr) {
-    RMW_SET_ERROR_MSG("failed to create sample info sequence");
-    dds_DataSeq_delete(data_values);
-    return RMW_RET_ERROR;
+  // The whole batch is taken by one raw take, so the sequences must hold count samples. Those of
+  // the allocation, or else of the subscription, are grown as needed and kept for the next
+  // batch. A take that races with another one gets temporary storage instead of blocking.
+  GurumddsTakeSequences * batch_sequences = &info->batch_sequences;
+  std::vector<GurumddsTakenSample> * batch_samples = &info->batch_samples;
+  if (allocation != nullptr) {
+    rmw_ret_t rmw_ret = _get_take_sequences(info, allocation, &batch_sequences);
+    if (rmw_ret != RMW_RET_OK) {
+      return rmw_ret;
+    }
+    batch_samples = &static_cast<GurumddsSubscriptionAllocation *>(allocation->data)->batch_samples;
   }
 
-  dds_UnsignedLongSeq * sample_sizes = dds_UnsignedLongSeq_create(count);
-  if (sample_sizes == nullptr) {
-    RMW_SET_ERROR_MSG("failed to create sample size sequence");
-    dds_DataSeq_delete(data_values);
-    dds_SampleInfoSeq_delete(sample_infos);
-    return RMW_RET_ERROR;
+  GurumddsTakeSequences temporary_sequences;
+  std::vector<GurumddsTakenSample> temporary_samples;
+  std::unique_lock<std::mutex> batch_lock(batch_sequences->mutex, std::try_to_lock);
+  if (!batch_lock.owns_lock()) {
+    batch_sequences = &temporary_sequences;
+    batch_samples = &temporary_samples;
+  }
+  if (batch_sequences->length < count) {
+    batch_sequences->fini();
+    if (!batch_sequences->init(static_cast<uint32_t>(count))) {
+      RMW_SET_ERROR_MSG("failed to create take sequences");
+      return RMW_RET_ERROR;
+    }
   }
+  GurumddsTakeSequences & sequences = *batch_sequences;
+  std::vector<GurumddsTakenSample> & samples = *batch_samples;
+  samples.reserve(count);
+
+  const size_t thread_count = static_cast<size_t>(info->ctx->take_sequence_threads);
+  const uint64_t parallel_bytes = info->ctx->take_sequence_parallel_bytes;
 
   while (*taken < count) {
-    dds_ReturnCode_t ret = dds_DataReader_raw_take(
-      topic_reader, dds_HANDLE_NIL, data_values, sample_infos, sample_sizes, count,
+    dds_ReturnCode_t ret = dds_DataReader_raw_take_w_sampleinfoex(
+      topic_reader, dds_HANDLE_NIL, sequences.data_values, sequences.sample_infos,
+      sequences.sample_sizes, static_cast<uint32_t>(count - *taken),
       dds_ANY_SAMPLE_STATE, dds_ANY_VIEW_STATE, dds_ANY_INSTANCE_STATE);
 
     if (ret == dds_RETCODE_NO_DATA) {
       RCUTILS_LOG_DEBUG_NAMED(
         RMW_GURUMDDS_ID, "No data on topic %s", subscription->topic_name);
-      dds_DataReader_raw_return_loan(topic_reader, data_values, sample_infos, sample_sizes);
+      dds_DataReader_raw_return_loan(
+        topic_reader, sequences.data_values, sequences.sample_infos, sequences.sample_sizes);
       break;
     }
 
     if (ret != dds_RETCODE_OK) {
       RMW_SET_ERROR_MSG("failed to take data");
-      dds_DataReader_raw_return_loan(topic_reader, data_values, sample_infos, sample_sizes);
-      dds_DataSeq_delete(data_values);
-      dds_SampleInfoSeq_delete(sample_infos);
-      dds_UnsignedLongSeq_delete(sample_sizes);
+      dds_DataReader_raw_return_loan(
+        topic_reader, sequences.data_values, sequences.sample_infos, sequences.sample_sizes);
       return RMW_RET_ERROR;
     }
 
     RCUTILS_LOG_DEBUG_NAMED(
       RMW_GURUMDDS_ID, "Received data on topic %s", subscription->topic_name);
 
-    for (uint32_t i = 0; i < dds_SampleInfoSeq_length(sample_infos); i++) {
-      dds_SampleInfo * sample_info = dds_SampleInfoSeq_get(sample_infos, i);
-
-      if (sample_info->valid_data) {
-        void * sample = dds_DataSeq_get(data_values, i);
-        if (sample == nullptr) {
-          RMW_SET_ERROR_MSG("failed to get message");
-          dds_DataReader_raw_return_loan(topic_reader, data_values, sample_infos, sample_sizes);
-          dds_DataSeq_delete(data_values);
-          dds_SampleInfoSeq_delete(sample_infos);
-          dds_UnsignedLongSeq_delete(sample_sizes);
-          return RMW_RET_ERROR;
-        }
-        uint32_t sample_size = dds_UnsignedLongSeq_get(sample_sizes, i);
-        bool result = deserialize_cdr_to_ros(
-          info->rosidl_message_typesupport->data,
-          info->rosidl_message_typesupport->typesupport_identifier,
-          message_sequence->data[*taken],
-          sample,
-          static_cast<size_t>(sample_size)
-        );
-        if (!result) {
-          RMW_SET_ERROR_MSG("failed to deserialize message");
-          dds_DataReader_raw_return_loan(topic_reader, data_values, sample_infos, sample_sizes);
-          dds_DataSeq_delete(data_values);
-          dds_SampleInfoSeq_delete(sample_infos);
-          dds_UnsignedLongSeq_delete(sample_sizes);
-          return RMW_RET_ERROR;
-        }
-
-        auto message_info = &(message_info_sequence->data[*taken]);
-
-        message_info->source_timestamp =
-          sample_info->source_timestamp.sec * static_cast<int64_t>(1000000000) +
-          sample_info->source_timestamp.nanosec;
-        // TODO(clemjh): SampleInfo doesn't contain received_timestamp
-        message_info->received_timestamp = 0;
-        rmw_gid_t * sender_gid = &message_info->publisher_gid;
-        sender_gid->implementation_identifier = RMW_GURUMDDS_ID;
-        memset(sender_gid->data, 0, RMW_GID_STORAGE_SIZE);
-
-        dds_ReturnCode_t ret = dds_DataReader_get_guid_from_publication_handle(
-          topic_reader, sample_info->publication_handle, sender_gid->data);
-        if (ret != dds_RETCODE_OK) {
-          if (ret == dds_RETCODE_ERROR) {
-            RCUTILS_LOG_WARN_NAMED(RMW_GURUMDDS_ID, "Failed to get publication handle");
-          }
-          memset(sender_gid->data, 0, RMW_GID_STORAGE_SIZE);
-        }
+    // Message infos are filled in sample order before the messages are deserialized
+    samples.clear();
+    uint64_t batch_bytes = 0;
+    uint32_t sample_count = dds_SampleInfoSeq_length(sequences.sample_infos);
+    for (uint32_t i = 0; i < sample_count; i++) {
+      dds_SampleInfo * sample_info = dds_SampleInfoSeq_get(sequences.sample_infos, i);
+      if (!sample_info->valid_data) {
+        continue;
+      }
 
-        (*taken)++;
+      void * sample = dds_DataSeq_get(sequences.data_values, i);
+      if (sample == nullptr) {
+        RMW_SET_ERROR_MSG("failed to get message");
+        dds_DataReader_raw_return_loan(
+          topic_reader, sequences.data_values, sequences.sample_infos, sequences.sample_sizes);
+        return RMW_RET_ERROR;
       }
+
+      size_t index = *taken + samples.size();
+      uint32_t sample_size = dds_UnsignedLongSeq_get(sequences.sample_sizes, i);
+      samples.push_back({sample, static_cast<size_t>(sample_size), message_sequence->data[index]});
+      batch_bytes += sample_size;
+
+      _fill_message_info(
+        RMW_GURUMDDS_ID, info, sample_info, ++info->reception_sequence_number,
+        &message_info_sequence->data[index]);
     }
-    dds_DataReader_raw_return_loan(topic_reader, data_values, sample_infos, sample_sizes);
+
+    bool parallel = thread_count > 1 && parallel_bytes > 0 && batch_bytes >= parallel_bytes;
+    bool result = _deserialize_batch(info, samples, parallel ? thread_count : 1);
+    dds_DataReader_raw_return_loan(
+      topic_reader, sequences.data_values, sequences.sample_infos, sequences.sample_sizes);
+    if (!result) {
+      RMW_SET_ERROR_MSG("failed to deserialize message");
+      return RMW_RET_ERROR;
+    }
+
+    *taken += samples.size();
   }
 
   message_sequence->size = *taken;
   message_info_sequence->size = *taken;
 
-  dds_DataSeq_delete(data_values);
-  dds_SampleInfoSeq_delete(sample_infos);
-  dds_UnsignedLongSeq_delete(sample_sizes);
-
   return RMW_RET_OK;
 }
 
@@ -1012,13 +1452,7 @@ rmw_take_loaned_message(
   bool * taken,
   rmw_subscription_allocation_t * allocation)
 {
-  (void)subscription;
-  (void)loaned_message;
-  (void)taken;
-  (void)allocation;
-
-  RMW_SET_ERROR_MSG("rmw_take_loaned_message is not supported");
-  return RMW_RET_UNSUPPORTED;
+  return _take_loaned(subscription, loaned_message, taken, nullptr, allocation);
 }
 
 rmw_ret_t
@@ -1029,14 +1463,8 @@ rmw_take_loaned_message_with_info(
   rmw_message_info_t * message_info,
   rmw_subscription_allocation_t * allocation)
 {
-  (void)subscription;
-  (void)loaned_message;
-  (void)taken;
-  (void)message_info;
-  (void)allocation;
-
-  RMW_SET_ERROR_MSG("rmw_take_loaned_message_with_info is not supported");
-  return RMW_RET_UNSUPPORTED;
+  RMW_CHECK_ARGUMENT_FOR_NULL(message_info, RMW_RET_INVALID_ARGUMENT);
+  return _take_loaned(subscription, loaned_message, taken, message_info, allocation);
 }
 
 rmw_ret_t
@@ -1044,11 +1472,48 @@ rmw_return_loaned_message_from_subscription(
   const rmw_subscription_t * subscription,
   void * loaned_message)
 {
-  (void)subscription;
-  (void)loaned_message;
+  RMW_CHECK_ARGUMENT_FOR_NULL(subscription, RMW_RET_INVALID_ARGUMENT);
+  RMW_CHECK_ARGUMENT_FOR_NULL(loaned_message, RMW_RET_INVALID_ARGUMENT);
+  RMW_CHECK_TYPE_IDENTIFIERS_MATCH(
+    subscription,
+    subscription->implementation_identifier,
+    RMW_GURUMDDS_ID,
+    return RMW_RET_INCORRECT_RMW_IMPLEMENTATION);
 
-  RMW_SET_ERROR_MSG("rmw_return_loaned_message_from_subscription is not supported");
-  return RMW_RET_UNSUPPORTED;
+  if (!subscription->can_loan_messages) {
+    RMW_SET_ERROR_MSG("Loaning is not supported");
+    return RMW_RET_UNSUPPORTED;
+  }
+
+  auto subscriber_info = static_cast<GurumddsSubscriberInfo *>(subscription->data);
+  RCUTILS_CHECK_ARGUMENT_FOR_NULL(subscriber_info, RMW_RET_ERROR);
+
+  std::unique_ptr<GurumddsTakeSequences> sequences;
+  {
+    std::lock_guard<std::mutex> lock(subscriber_info->raw_loans_mutex);
+    auto it = subscriber_info->raw_loans.find(loaned_message);
+    if (it != subscriber_info->raw_loans.end()) {
+      sequences = std::move(it->second);
+      subscriber_info->raw_loans.erase(it);
+    }
+  }
+
+  if (sequences == nullptr) {
+    subscriber_info->serialization_plan->fini_message(loaned_message);
+    subscriber_info->loan_pool.release(loaned_message);
+    return RMW_RET_OK;
+  }
+
+  dds_ReturnCode_t ret = dds_DataReader_raw_return_loan(
+    subscriber_info->topic_reader,
+    sequences->data_values, sequences->sample_infos, sequences->sample_sizes);
+  _release_raw_loan_sequences(subscriber_info, std::move(sequences));
+  if (ret != dds_RETCODE_OK) {
+    RMW_SET_ERROR_MSG("failed to return loan");
+    return RMW_RET_ERROR;
+  }
+
+  return RMW_RET_OK;
 }
 
 rmw_ret_t
@@ -1057,12 +1522,40 @@ rmw_subscription_set_on_new_message_callback(
   rmw_event_callback_t callback,
   const void * user_data)
 {
-  (void)subscription;
-  (void)callback;
-  (void)user_data;
+  RCUTILS_CHECK_FOR_NULL_WITH_MSG(
+    subscription, "subscription handle is null", return RMW_RET_INVALID_ARGUMENT);
+  RMW_CHECK_TYPE_IDENTIFIERS_MATCH(
+    subscription,
+    subscription->implementation_identifier,
+    RMW_GURUMDDS_ID,
+    return RMW_RET_INCORRECT_RMW_IMPLEMENTATION);
 
-  RMW_SET_ERROR_MSG("rmw_subscription_set_on_new_message_callback not implemented");
-  return RMW_RET_UNSUPPORTED;
+  GurumddsSubscriberInfo * info = static_cast<GurumddsSubscriberInfo *>(subscription->data);
+  RCUTILS_CHECK_FOR_NULL_WITH_MSG(info, "custom subscriber info is null", return RMW_RET_ERROR);
+
+  if (callback == nullptr) {
+    if (_set_reader_listener(info->topic_reader, false) != dds_RETCODE_OK) {
+      RMW_SET_ERROR_MSG("failed to set datareader listener");
+      return RMW_RET_ERROR;
+    }
+    info->new_message_callback.set(nullptr, nullptr);
+    return RMW_RET_OK;
+  }
+
+  info->new_message_callback.set(callback, user_data);
+  if (_set_reader_listener(info->topic_reader, true) != dds_RETCODE_OK) {
+    info->new_message_callback.set(nullptr, nullptr);
+    RMW_SET_ERROR_MSG("failed to set datareader listener");
+    return RMW_RET_ERROR;
+  }
+
+  // Samples that arrived while no callback was set are still unread in the reader. The listener
+  // marks what it counts as read, so none of them is reported twice.
+  size_t count = _count_new_samples(info);
+  if (count > 0) {
+    info->new_message_callback.notify(count);
+  }
+  return RMW_RET_OK;
 }
 
 rmw_ret_t
@@ -1091,3 +1584,207 @@ rmw_subscription_get_content_filter(
   return RMW_RET_UNSUPPORTED;
 }
 }  // extern "C"
+
+namespace rmw_gurumdds_cpp
+{
+rmw_ret_t
+take_serialized_message_loans(
+  const rmw_subscription_t * subscription,
+  size_t count,
+  rmw_serialized_message_t * serialized_messages,
+  rmw_message_info_t * message_infos,
+  size_t * taken)
+{
+  RMW_CHECK_ARGUMENT_FOR_NULL(subscription, RMW_RET_INVALID_ARGUMENT);
+  RMW_CHECK_ARGUMENT_FOR_NULL(serialized_messages, RMW_RET_INVALID_ARGUMENT);
+  RMW_CHECK_ARGUMENT_FOR_NULL(taken, RMW_RET_INVALID_ARGUMENT);
+  RMW_CHECK_TYPE_IDENTIFIERS_MATCH(
+    subscription,
+    subscription->implementation_identifier,
+    RMW_GURUMDDS_ID,
+    return RMW_RET_INCORRECT_RMW_IMPLEMENTATION);
+
+  if (count == 0 || count > std::numeric_limits<uint32_t>::max()) {
+    RMW_SET_ERROR_MSG("count is out of range");
+    return RMW_RET_INVALID_ARGUMENT;
+  }
+
+  for (size_t i = 0; i < count; i++) {
+    if (serialized_messages[i].buffer != nullptr) {
+      RMW_SET_ERROR_MSG("serialized messages must be zero initialized");
+      return RMW_RET_INVALID_ARGUMENT;
+    }
+  }
+
+  *taken = 0;
+
+  auto subscriber_info = static_cast<GurumddsSubscriberInfo *>(subscription->data);
+  RCUTILS_CHECK_ARGUMENT_FOR_NULL(subscriber_info, RMW_RET_ERROR);
+
+  dds_DataReader * topic_reader = subscriber_info->topic_reader;
+  RCUTILS_CHECK_ARGUMENT_FOR_NULL(topic_reader, RMW_RET_ERROR);
+
+  std::unique_ptr<GurumddsTakeSequences> sequences;
+  if (count == 1) {
+    sequences = _acquire_raw_loan_sequences(subscriber_info);
+  } else {
+    sequences.reset(new(std::nothrow) GurumddsTakeSequences());
+    if (sequences != nullptr && !sequences->init(static_cast<uint32_t>(count))) {
+      sequences.reset();
+    }
+  }
+  if (sequences == nullptr) {
+    RMW_SET_ERROR_MSG("failed to create take sequences");
+    return RMW_RET_ERROR;
+  }
+  dds_DataSeq * data_values = sequences->data_values;
+  dds_SampleInfoSeq * sample_infos = sequences->sample_infos;
+  dds_UnsignedLongSeq * sample_sizes = sequences->sample_sizes;
+
+  dds_ReturnCode_t ret = dds_DataReader_raw_take_w_sampleinfoex(
+    topic_reader, dds_HANDLE_NIL, data_values, sample_infos, sample_sizes,
+    static_cast<uint32_t>(count), dds_ANY_SAMPLE_STATE, dds_ANY_VIEW_STATE,
+    dds_ANY_INSTANCE_STATE);
+
+  if (ret == dds_RETCODE_NO_DATA) {
+    RCUTILS_LOG_DEBUG_NAMED(
+      RMW_GURUMDDS_ID, "No data on topic %s", subscription->topic_name);
+    dds_DataReader_raw_return_loan(topic_reader, data_values, sample_infos, sample_sizes);
+    _release_raw_loan_sequences(subscriber_info, std::move(sequences));
+    return RMW_RET_OK;
+  }
+
+  if (ret != dds_RETCODE_OK) {
+    RMW_SET_ERROR_MSG("failed to take data");
+    dds_DataReader_raw_return_loan(topic_reader, data_values, sample_infos, sample_sizes);
+    _release_raw_loan_sequences(subscriber_info, std::move(sequences));
+    return RMW_RET_ERROR;
+  }
+
+  RCUTILS_LOG_DEBUG_NAMED(
+    RMW_GURUMDDS_ID, "Received data on topic %s", subscription->topic_name);
+
+  for (uint32_t i = 0; i < dds_SampleInfoSeq_length(sample_infos); i++) {
+    dds_SampleInfo * sample_info = dds_SampleInfoSeq_get(sample_infos, i);
+    void * sample = dds_DataSeq_get(data_values, i);
+    if (!sample_info->valid_data || sample == nullptr) {
+      continue;
+    }
+
+    rmw_serialized_message_t * serialized_message = &serialized_messages[*taken];
+    serialized_message->buffer = static_cast<uint8_t *>(sample);
+    serialized_message->buffer_length = dds_UnsignedLongSeq_get(sample_sizes, i);
+    serialized_message->buffer_capacity = serialized_message->buffer_length;
+    serialized_message->allocator = rcutils_get_zero_initialized_allocator();
+
+    int64_t reception_sequence_number = ++subscriber_info->reception_sequence_number;
+    if (message_infos != nullptr) {
+      _fill_message_info(
+        RMW_GURUMDDS_ID, subscriber_info, sample_info, reception_sequence_number,
+        &message_infos[*taken]);
+    }
+
+    (*taken)++;
+  }
+
+  if (*taken == 0) {
+    dds_DataReader_raw_return_loan(topic_reader, data_values, sample_infos, sample_sizes);
+    _release_raw_loan_sequences(subscriber_info, std::move(sequences));
+    return RMW_RET_OK;
+  }
+
+  // The whole batch is one DDS loan, recorded under its first message
+  std::lock_guard<std::mutex> lock(subscriber_info->raw_loans_mutex);
+  try {
+    subscriber_info->raw_loans.emplace(serialized_messages[0].buffer, std::move(sequences));
+  } catch (std::bad_alloc &) {
+    RMW_SET_ERROR_MSG("failed to record loaned messages");
+    for (size_t i = 0; i < *taken; i++) {
+      serialized_messages[i] = rmw_get_zero_initialized_serialized_message();
+    }
+    *taken = 0;
+    dds_DataReader_raw_return_loan(topic_reader, data_values, sample_infos, sample_sizes);
+    return RMW_RET_BAD_ALLOC;
+  }
+
+  return RMW_RET_OK;
+}
+
+rmw_ret_t
+return_serialized_message_loans(
+  const rmw_subscription_t * subscription,
+  rmw_serialized_message_t * serialized_messages,
+  size_t count)
+{
+  RMW_CHECK_ARGUMENT_FOR_NULL(subscription, RMW_RET_INVALID_ARGUMENT);
+  RMW_CHECK_ARGUMENT_FOR_NULL(serialized_messages, RMW_RET_INVALID_ARGUMENT);
+  RMW_CHECK_TYPE_IDENTIFIERS_MATCH(
+    subscription,
+    subscription->implementation_identifier,
+    RMW_GURUMDDS_ID,
+    return RMW_RET_INCORRECT_RMW_IMPLEMENTATION);
+
+  if (count == 0) {
+    RMW_SET_ERROR_MSG("count cannot be 0");
+    return RMW_RET_INVALID_ARGUMENT;
+  }
+
+  auto subscriber_info = static_cast<GurumddsSubscriberInfo *>(subscription->data);
+  RCUTILS_CHECK_ARGUMENT_FOR_NULL(subscriber_info, RMW_RET_ERROR);
+
+  std::unique_ptr<GurumddsTakeSequences> sequences;
+  {
+    std::lock_guard<std::mutex> lock(subscriber_info->raw_loans_mutex);
+    auto it = subscriber_info->raw_loans.find(serialized_messages[0].buffer);
+    if (it != subscriber_info->raw_loans.end()) {
+      sequences = std::move(it->second);
+      subscriber_info->raw_loans.erase(it);
+    }
+  }
+
+  if (sequences == nullptr) {
+    RMW_SET_ERROR_MSG("serialized messages are not loaned from this subscription");
+    return RMW_RET_INVALID_ARGUMENT;
+  }
+
+  dds_ReturnCode_t ret = dds_DataReader_raw_return_loan(
+    subscriber_info->topic_reader,
+    sequences->data_values, sequences->sample_infos, sequences->sample_sizes);
+  _release_raw_loan_sequences(subscriber_info, std::move(sequences));
+
+  for (size_t i = 0; i < count; i++) {
+    serialized_messages[i] = rmw_get_zero_initialized_serialized_message();
+  }
+
+  if (ret != dds_RETCODE_OK) {
+    RMW_SET_ERROR_MSG("failed to return loan");
+    return RMW_RET_ERROR;
+  }
+
+  return RMW_RET_OK;
+}
+
+rmw_ret_t
+take_serialized_message_loan(
+  const rmw_subscription_t * subscription,
+  rmw_serialized_message_t * serialized_message,
+  bool * taken,
+  rmw_message_info_t * message_info)
+{
+  RMW_CHECK_ARGUMENT_FOR_NULL(taken, RMW_RET_INVALID_ARGUMENT);
+
+  size_t count = 0;
+  rmw_ret_t ret = take_serialized_message_loans(
+    subscription, 1, serialized_message, message_info, &count);
+  *taken = count > 0;
+  return ret;
+}
+
+rmw_ret_t
+return_serialized_message_loan(
+  const rmw_subscription_t * subscription,
+  rmw_serialized_message_t * serialized_message)
+{
+  return return_serialized_message_loans(subscription, serialized_message, 1);
+}
+}  // namespace rmw_gurumdds_cpp
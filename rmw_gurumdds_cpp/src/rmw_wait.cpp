@@ -12,6 +12,13 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <algorithm>
+#include <mutex>
+#include <new>
+#include <unordered_set>
+
+#include "rcutils/logging_macros.h"
+
 #include "rmw/allocators.h"
 #include "rmw/error_handling.h"
 #include "rmw/rmw.h"
@@ -19,8 +26,53 @@
 
 #include "rmw_gurumdds_cpp/dds_include.hpp"
 #include "rmw_gurumdds_cpp/identifier.hpp"
+#include "rmw_gurumdds_cpp/rmw_context_impl.hpp"
 #include "rmw_gurumdds_cpp/rmw_wait.hpp"
 
+static std::mutex g_wait_sets_mutex;
+static std::unordered_set<GurumddsWaitSetInfo *> g_wait_sets;
+
+void wait_sets_forget_condition(dds_Condition * condition)
+{
+  std::lock_guard<std::mutex> registry_lock(g_wait_sets_mutex);
+  for (GurumddsWaitSetInfo * wait_set_info : g_wait_sets) {
+    std::lock_guard<std::mutex> lock(wait_set_info->attached_mutex);
+    // The entity is going away, so its entry is dropped without touching its status condition.
+    // The next rmw_wait then gathers its events again.
+    auto & event_conditions = wait_set_info->event_conditions;
+    auto event_it = std::find_if(
+      event_conditions.begin(), event_conditions.end(),
+      [condition](const GurumddsWaitSetInfo::EventCondition & entry) {
+        return reinterpret_cast<dds_Condition *>(entry.condition) == condition;
+      });
+    bool event_condition_found = event_it != event_conditions.end();
+    if (event_condition_found) {
+      event_conditions.erase(event_it);
+    }
+    for (auto matched_condition : wait_set_info->matched_conditions) {
+      if (reinterpret_cast<dds_Condition *>(matched_condition) == condition) {
+        event_condition_found = true;
+        break;
+      }
+    }
+    if (event_condition_found) {
+      wait_set_info->cached_events.clear();
+      wait_set_info->matched_conditions.clear();
+      wait_set_info->events_gathered = false;
+    }
+
+    auto it = wait_set_info->attached.find(condition);
+    if (it == wait_set_info->attached.end()) {
+      continue;
+    }
+
+    if (dds_WaitSet_detach_condition(wait_set_info->wait_set, condition) != dds_RETCODE_OK) {
+      RCUTILS_LOG_WARN_NAMED(RMW_GURUMDDS_ID, "failed to detach condition from wait set");
+    }
+    wait_set_info->attached.erase(it);
+  }
+}
+
 extern "C"
 {
 rmw_wait_set_t *
@@ -48,14 +100,17 @@ rmw_create_wait_set(rmw_context_t * context, size_t max_conditions)
   }
 
   wait_set->implementation_identifier = RMW_GURUMDDS_ID;
-  wait_set->data = rmw_allocate(sizeof(GurumddsWaitSetInfo));
-  wait_set_info = static_cast<GurumddsWaitSetInfo *>(wait_set->data);
+  wait_set_info = new(std::nothrow) GurumddsWaitSetInfo();
+  wait_set->data = wait_set_info;
 
   if (!wait_set_info) {
     RMW_SET_ERROR_MSG("failed to allocate wait set");
     goto fail;
   }
 
+  wait_set_info->spin_ns = context->impl->wait_spin_ns;
+  wait_set_info->yield_ns = context->impl->wait_yield_ns;
+
   wait_set_info->wait_set = dds_WaitSet_create();
   if (wait_set_info->wait_set == nullptr) {
     RMW_SET_ERROR_MSG("failed to allocate wait set");
@@ -74,6 +129,11 @@ rmw_create_wait_set(rmw_context_t * context, size_t max_conditions)
     goto fail;
   }
 
+  {
+    std::lock_guard<std::mutex> registry_lock(g_wait_sets_mutex);
+    g_wait_sets.insert(wait_set_info);
+  }
+
   return wait_set;
 
 fail:
@@ -90,14 +150,11 @@ fail:
       dds_WaitSet_delete(wait_set_info->wait_set);
     }
 
+    delete wait_set_info;
     wait_set_info = nullptr;
   }
 
   if (wait_set != nullptr) {
-    if (wait_set->data != nullptr) {
-      rmw_free(wait_set->data);
-    }
-
     rmw_wait_set_free(wait_set);
   }
 
@@ -116,6 +173,23 @@ rmw_destroy_wait_set(rmw_wait_set_t * wait_set)
 
   GurumddsWaitSetInfo * wait_set_info = static_cast<GurumddsWaitSetInfo *>(wait_set->data);
 
+  {
+    std::lock_guard<std::mutex> registry_lock(g_wait_sets_mutex);
+    g_wait_sets.erase(wait_set_info);
+  }
+
+  for (auto & event_condition : wait_set_info->event_conditions) {
+    event_condition.event_info->set_wait_set_statuses(wait_set_info, 0);
+  }
+  wait_set_info->event_conditions.clear();
+
+  for (auto & attached : wait_set_info->attached) {
+    if (dds_WaitSet_detach_condition(wait_set_info->wait_set, attached.first) != dds_RETCODE_OK) {
+      RCUTILS_LOG_WARN_NAMED(RMW_GURUMDDS_ID, "failed to detach condition from wait set");
+    }
+  }
+  wait_set_info->attached.clear();
+
   if (wait_set_info->active_conditions != nullptr) {
     dds_ConditionSeq_delete(wait_set_info->active_conditions);
   }
@@ -128,11 +202,9 @@ rmw_destroy_wait_set(rmw_wait_set_t * wait_set)
     dds_WaitSet_delete(wait_set_info->wait_set);
   }
 
+  delete wait_set_info;
   wait_set_info = nullptr;
-
-  if (wait_set->data != nullptr) {
-    rmw_free(wait_set->data);
-  }
+  wait_set->data = nullptr;
 
   if (wait_set != nullptr) {
     rmw_wait_set_free(wait_set);
@@ -0,0 +1,734 @@
+// Copyright 2023 GurumNetworks, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef SERIALIZATION_PLAN_HPP_
+#define SERIALIZATION_PLAN_HPP_
+
+#include <algorithm>
+#include <array>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "rmw/error_handling.h"
+
+#include "rosidl_runtime_c/message_initialization.h"
+#include "rosidl_runtime_cpp/message_initialization.hpp"
+
+#include "rosidl_typesupport_introspection_c/identifier.h"
+#include "rosidl_typesupport_introspection_c/message_introspection.h"
+
+#include "rosidl_typesupport_introspection_cpp/field_types.hpp"
+#include "rosidl_typesupport_introspection_cpp/identifier.hpp"
+#include "rosidl_typesupport_introspection_cpp/message_introspection.hpp"
+
+#include "cdr_buffer.hpp"
+#include "message_converter.hpp"
+
+// A serialization plan is a flat list of operations compiled once from the introspection
+// members of a message type. Nested structs are inlined and adjacent fixed-size primitives
+// of the same width which are also contiguous in memory are merged into a single copy.
+// Everything else is delegated to MessageSerializer / MessageDeserializer member by member.
+class SerializationPlan
+{
+public:
+  virtual ~SerializationPlan() = default;
+
+  virtual void serialize(CDRSerializationBuffer & buffer, const uint8_t * input) const = 0;
+  virtual void deserialize(CDRDeserializationBuffer & buffer, uint8_t * output) const = 0;
+
+  // Number of leading bytes of the in-memory message which are exactly its CDR payload.
+  // It is 0 unless the type is fixed-size and its layout matches CDR without any padding.
+  size_t get_plain_size() const
+  {
+    return plain_size;
+  }
+
+  // Serialized size including the CDR header for plain types, 0 otherwise
+  size_t get_fixed_serialized_size() const
+  {
+    if (plain_size == 0) {
+      return 0;
+    }
+    return CDR_HEADER_SIZE + ((plain_size + 3) & ~static_cast<size_t>(3));
+  }
+
+  // Upper bound of the serialized size including the CDR header, 0 when the type is unbounded
+  size_t get_max_serialized_size() const
+  {
+    return max_serialized_size;
+  }
+
+  // Alignment a plain message needs in memory, which is its widest primitive
+  size_t get_plain_alignment() const
+  {
+    return plain_alignment;
+  }
+
+  // True when the type has no strings or sequences, so its messages never own memory
+  bool is_fixed_size() const
+  {
+    return fixed_size;
+  }
+
+  // In-memory size of a message
+  size_t get_message_size() const
+  {
+    return message_size;
+  }
+
+  // Construct or destroy a message in storage of get_message_size() bytes
+  virtual void init_message(void * message) const = 0;
+  virtual void fini_message(void * message) const = 0;
+
+protected:
+  size_t plain_size = 0;
+  size_t plain_alignment = 1;
+  size_t max_serialized_size = 0;
+  size_t message_size = 0;
+  bool fixed_size = true;
+};
+
+inline void init_message_members(
+  const rosidl_typesupport_introspection_c__MessageMembers * members, void * message)
+{
+  members->init_function(message, ROSIDL_RUNTIME_C_MSG_INIT_ALL);
+}
+
+inline void init_message_members(
+  const rosidl_typesupport_introspection_cpp::MessageMembers * members, void * message)
+{
+  members->init_function(message, rosidl_runtime_cpp::MessageInitialization::ALL);
+}
+
+template<typename MessageMembersT>
+class MessageSerializationPlan : public SerializationPlan
+{
+  using MessageMemberT = typename std::remove_const<
+    typename std::remove_pointer<decltype(MessageMembersT::members_)>::type>::type;
+
+  enum class OpKind
+  {
+    COPY,
+    MEMBER,
+    STRUCT_ARRAY
+  };
+
+  struct Op
+  {
+    OpKind kind;
+    // COPY: offset of the first element, MEMBER: offset of the enclosing struct,
+    // STRUCT_ARRAY: offset of the array or sequence field
+    size_t offset;
+    size_t width;
+    size_t count;
+    const MessageMemberT * member;
+    std::shared_ptr<MessageSerializationPlan> element_plan;
+  };
+
+public:
+  explicit MessageSerializationPlan(const MessageMembersT * members)
+  : message_members(members),
+    size_of(members->size_of_)
+  {
+    compile(members, 0);
+    plain_size = compute_plain_size();
+    if (plain_size > 0) {
+      for (const auto & op : ops) {
+        plain_alignment = std::max(plain_alignment, op.width);
+      }
+    }
+    message_size = size_of;
+
+    MaxOffsets max_offsets;
+    max_offsets.fill(-1);
+    max_offsets[0] = 0;
+    if (compute_max_offsets(members, max_offsets)) {
+      max_offsets = max_align(max_offsets, 4);
+      max_serialized_size =
+        CDR_HEADER_SIZE + *std::max_element(max_offsets.begin(), max_offsets.end());
+    }
+  }
+
+  void init_message(void * message) const override
+  {
+    init_message_members(message_members, message);
+  }
+
+  void fini_message(void * message) const override
+  {
+    message_members->fini_function(message);
+  }
+
+  void serialize(CDRSerializationBuffer & buffer, const uint8_t * input) const override
+  {
+    if (plain_size > 0) {
+      buffer.copy_arr(input, plain_size);
+    } else {
+      MessageSerializer serializer(buffer);
+      serialize_fields(buffer, serializer, input);
+    }
+    buffer.roundup(4);
+  }
+
+  void deserialize(CDRDeserializationBuffer & buffer, uint8_t * output) const override
+  {
+    if (plain_size > 0 && !buffer.needs_swap()) {
+      buffer.copy_arr(output, plain_size);
+      return;
+    }
+    MessageDeserializer deserializer(buffer);
+    deserialize_fields(buffer, deserializer, output);
+  }
+
+private:
+  static size_t copy_width(const MessageMemberT * member)
+  {
+    if (member->is_array_ && (!member->array_size_ || member->is_upper_bound_)) {
+      return 0;
+    }
+
+    switch (member->type_id_) {
+      case rosidl_typesupport_introspection_cpp::ROS_TYPE_CHAR:
+      case rosidl_typesupport_introspection_cpp::ROS_TYPE_OCTET:
+      case rosidl_typesupport_introspection_cpp::ROS_TYPE_UINT8:
+      case rosidl_typesupport_introspection_cpp::ROS_TYPE_INT8:
+        return 1;
+      case rosidl_typesupport_introspection_cpp::ROS_TYPE_UINT16:
+      case rosidl_typesupport_introspection_cpp::ROS_TYPE_INT16:
+        return 2;
+      case rosidl_typesupport_introspection_cpp::ROS_TYPE_FLOAT:
+      case rosidl_typesupport_introspection_cpp::ROS_TYPE_UINT32:
+      case rosidl_typesupport_introspection_cpp::ROS_TYPE_INT32:
+        return 4;
+      case rosidl_typesupport_introspection_cpp::ROS_TYPE_DOUBLE:
+      case rosidl_typesupport_introspection_cpp::ROS_TYPE_UINT64:
+      case rosidl_typesupport_introspection_cpp::ROS_TYPE_INT64:
+        return 8;
+      default:
+        // bool is normalized, wchar is widened and long double does not match its CDR size
+        return 0;
+    }
+  }
+
+  static bool is_fixed_size_member(const MessageMemberT * member)
+  {
+    if (member->is_array_ && (!member->array_size_ || member->is_upper_bound_)) {
+      return false;
+    }
+    return member->type_id_ != rosidl_typesupport_introspection_cpp::ROS_TYPE_STRING &&
+           member->type_id_ != rosidl_typesupport_introspection_cpp::ROS_TYPE_WSTRING;
+  }
+
+  static size_t primitive_width(uint8_t type_id)
+  {
+    switch (type_id) {
+      case rosidl_typesupport_introspection_cpp::ROS_TYPE_BOOLEAN:
+      case rosidl_typesupport_introspection_cpp::ROS_TYPE_CHAR:
+      case rosidl_typesupport_introspection_cpp::ROS_TYPE_OCTET:
+      case rosidl_typesupport_introspection_cpp::ROS_TYPE_UINT8:
+      case rosidl_typesupport_introspection_cpp::ROS_TYPE_INT8:
+        return 1;
+      case rosidl_typesupport_introspection_cpp::ROS_TYPE_UINT16:
+      case rosidl_typesupport_introspection_cpp::ROS_TYPE_INT16:
+        return 2;
+      case rosidl_typesupport_introspection_cpp::ROS_TYPE_FLOAT:
+      case rosidl_typesupport_introspection_cpp::ROS_TYPE_UINT32:
+      case rosidl_typesupport_introspection_cpp::ROS_TYPE_INT32:
+      case rosidl_typesupport_introspection_cpp::ROS_TYPE_WCHAR:
+        return 4;
+      case rosidl_typesupport_introspection_cpp::ROS_TYPE_DOUBLE:
+      case rosidl_typesupport_introspection_cpp::ROS_TYPE_LONG_DOUBLE:
+      case rosidl_typesupport_introspection_cpp::ROS_TYPE_UINT64:
+      case rosidl_typesupport_introspection_cpp::ROS_TYPE_INT64:
+        return 8;
+      default:
+        return 0;
+    }
+  }
+
+  // Largest reachable CDR offset for each residue modulo 8, -1 when the residue cannot occur.
+  // Later padding only depends on the residue, so keeping the largest offset per residue gives
+  // the exact maximum even though bounded strings and sequences vary in length.
+  using MaxOffsets = std::array<int64_t, 8>;
+
+  static MaxOffsets max_align(const MaxOffsets & offsets, size_t width)
+  {
+    MaxOffsets result;
+    result.fill(-1);
+    for (int64_t offset : offsets) {
+      if (offset >= 0) {
+        int64_t aligned = (offset + width - 1) & ~static_cast<int64_t>(width - 1);
+        result[aligned % 8] = std::max(result[aligned % 8], aligned);
+      }
+    }
+    return result;
+  }
+
+  // Advances by step * k bytes for any k in [min_count, max_count]
+  static MaxOffsets max_advance(
+    const MaxOffsets & offsets, size_t step, size_t min_count, size_t max_count)
+  {
+    MaxOffsets result;
+    result.fill(-1);
+    // step * k modulo 8 repeats every 8 counts, so smaller counts are dominated
+    size_t first = max_count >= min_count + 8 ? max_count - 7 : min_count;
+    for (int64_t offset : offsets) {
+      if (offset < 0) {
+        continue;
+      }
+      for (size_t count = first; count <= max_count; count++) {
+        int64_t advanced = offset + static_cast<int64_t>(step * count);
+        result[advanced % 8] = std::max(result[advanced % 8], advanced);
+      }
+    }
+    return result;
+  }
+
+  static void max_merge(MaxOffsets & offsets, const MaxOffsets & other)
+  {
+    for (size_t i = 0; i < offsets.size(); i++) {
+      offsets[i] = std::max(offsets[i], other[i]);
+    }
+  }
+
+  // How far one element moves an offset with each residue modulo 8, per resulting residue,
+  // -1 when that residue cannot be reached. Since an element only depends on the residue it
+  // starts at, its effect on any MaxOffsets follows from these 8 rows, and the effect of many
+  // elements is found by combining steps instead of walking every element.
+  using MaxStep = std::array<MaxOffsets, 8>;
+
+  static MaxStep max_step_identity()
+  {
+    MaxStep step;
+    for (size_t from = 0; from < step.size(); from++) {
+      step[from].fill(-1);
+      step[from][from] = 0;
+    }
+    return step;
+  }
+
+  static MaxOffsets max_apply(const MaxOffsets & offsets, const MaxStep & step)
+  {
+    MaxOffsets result;
+    result.fill(-1);
+    for (size_t from = 0; from < offsets.size(); from++) {
+      if (offsets[from] < 0) {
+        continue;
+      }
+      for (size_t to = 0; to < result.size(); to++) {
+        if (step[from][to] >= 0) {
+          result[to] = std::max(result[to], offsets[from] + step[from][to]);
+        }
+      }
+    }
+    return result;
+  }
+
+  // first followed by second
+  static MaxStep max_combine(const MaxStep & first, const MaxStep & second)
+  {
+    MaxStep result;
+    for (size_t from = 0; from < first.size(); from++) {
+      result[from] = max_apply(first[from], second);
+    }
+    return result;
+  }
+
+  // step applied count times
+  static MaxStep max_repeat(MaxStep step, size_t count)
+  {
+    MaxStep result = max_step_identity();
+    while (count > 0) {
+      if (count & 1) {
+        result = max_combine(result, step);
+      }
+      count >>= 1;
+      if (count > 0) {
+        step = max_combine(step, step);
+      }
+    }
+    return result;
+  }
+
+  // Returns false when the element has no upper bound
+  static bool max_element_step(const MessageMemberT * member, MaxStep & step)
+  {
+    for (size_t from = 0; from < step.size(); from++) {
+      MaxOffsets offsets;
+      offsets.fill(-1);
+      offsets[from] = static_cast<int64_t>(from);
+      if (!max_element(member, offsets)) {
+        return false;
+      }
+      for (size_t to = 0; to < offsets.size(); to++) {
+        step[from][to] = offsets[to] < 0 ? -1 : offsets[to] - static_cast<int64_t>(from);
+      }
+    }
+    return true;
+  }
+
+  // Applies one element of a non-primitive member, returns false when it has no upper bound
+  static bool max_element(const MessageMemberT * member, MaxOffsets & offsets)
+  {
+    switch (member->type_id_) {
+      case rosidl_typesupport_introspection_cpp::ROS_TYPE_STRING:
+        if (member->string_upper_bound_ == 0) {
+          return false;
+        }
+        offsets = max_advance(max_align(offsets, 4), 4, 1, 1);
+        offsets = max_advance(offsets, 1, 1, member->string_upper_bound_ + 1);
+        return true;
+      case rosidl_typesupport_introspection_cpp::ROS_TYPE_WSTRING:
+        if (member->string_upper_bound_ == 0) {
+          return false;
+        }
+        offsets = max_advance(max_align(offsets, 4), 4, 1, 1);
+        offsets = max_advance(max_align(offsets, 2), 2, 0, member->string_upper_bound_);
+        return true;
+      case rosidl_typesupport_introspection_cpp::ROS_TYPE_MESSAGE:
+        return compute_max_offsets(
+          static_cast<const MessageMembersT *>(member->members_->data), offsets);
+      default:
+        return false;
+    }
+  }
+
+  // Walks the members the way MessageSerializer writes them. Returns false when a string or
+  // sequence has no upper bound.
+  static bool compute_max_offsets(const MessageMembersT * members, MaxOffsets & offsets)
+  {
+    for (uint32_t i = 0; i < members->member_count_; i++) {
+      auto member = members->members_ + i;
+      size_t width = primitive_width(member->type_id_);
+
+      if (!member->is_array_) {
+        if (width > 0) {
+          offsets = max_advance(max_align(offsets, width), width, 1, 1);
+        } else if (!max_element(member, offsets)) {
+          return false;
+        }
+        continue;
+      }
+
+      if (member->array_size_ == 0) {
+        return false;
+      }
+
+      if (!member->is_upper_bound_) {
+        if (width > 0) {
+          offsets = max_advance(
+            max_align(offsets, width), width, member->array_size_, member->array_size_);
+        } else {
+          MaxStep step;
+          if (!max_element_step(member, step)) {
+            return false;
+          }
+          offsets = max_apply(offsets, max_repeat(step, member->array_size_));
+        }
+        continue;
+      }
+
+      offsets = max_advance(max_align(offsets, 4), 4, 1, 1);
+      if (width > 0) {
+        // An empty sequence may or may not be followed by the element alignment
+        MaxOffsets elements = max_advance(max_align(offsets, width), width, 0, member->array_size_);
+        max_merge(offsets, elements);
+      } else {
+        // Taking either no element or one, array_size_ times, reaches every shorter sequence
+        MaxStep step;
+        if (!max_element_step(member, step)) {
+          return false;
+        }
+        for (size_t from = 0; from < step.size(); from++) {
+          step[from][from] = std::max<int64_t>(step[from][from], 0);
+        }
+        offsets = max_apply(offsets, max_repeat(step, member->array_size_));
+      }
+    }
+    return true;
+  }
+
+  void compile(const MessageMembersT * members, size_t base)
+  {
+    for (uint32_t i = 0; i < members->member_count_; i++) {
+      auto member = members->members_ + i;
+      size_t offset = base + member->offset_;
+      size_t width = copy_width(member);
+      if (width > 0) {
+        size_t count = member->is_array_ ? member->array_size_ : 1;
+        if (!ops.empty()) {
+          Op & last = ops.back();
+          if (last.kind == OpKind::COPY && last.width == width &&
+            last.offset + last.count * width == offset)
+          {
+            last.count += count;
+            continue;
+          }
+        }
+        ops.push_back(Op{OpKind::COPY, offset, width, count, member, nullptr});
+      } else if (member->type_id_ == rosidl_typesupport_introspection_cpp::ROS_TYPE_MESSAGE) {
+        auto inner = static_cast<const MessageMembersT *>(member->members_->data);
+        if (!member->is_array_) {
+          compile(inner, offset);
+        } else {
+          auto element_plan = std::make_shared<MessageSerializationPlan>(inner);
+          fixed_size = fixed_size && is_fixed_size_member(member) && element_plan->fixed_size;
+          ops.push_back(Op{OpKind::STRUCT_ARRAY, offset, 0, 0, member, element_plan});
+        }
+      } else {
+        fixed_size = fixed_size && is_fixed_size_member(member);
+        ops.push_back(Op{OpKind::MEMBER, base, 0, 0, member, nullptr});
+      }
+    }
+  }
+
+  // A message is plain when it consists of copy operations only and, starting from CDR
+  // offset 0, every run lands on its in-memory offset without needing alignment padding.
+  size_t compute_plain_size() const
+  {
+    size_t cdr_offset = 0;
+    for (const auto & op : ops) {
+      if (op.kind != OpKind::COPY || op.offset != cdr_offset || cdr_offset % op.width != 0) {
+        return 0;
+      }
+      cdr_offset += op.width * op.count;
+    }
+    return cdr_offset;
+  }
+
+  // True when an element is one contiguous run, so arrays of it are copied at once
+  bool is_dense() const
+  {
+    return ops.size() == 1 && ops[0].kind == OpKind::COPY && ops[0].offset == 0 &&
+           ops[0].width * ops[0].count == size_of;
+  }
+
+  static void copy(
+    CDRSerializationBuffer & buffer, const uint8_t * data, size_t width, size_t count)
+  {
+    switch (width) {
+      case 1:
+        buffer.copy_arr(data, count);
+        break;
+      case 2:
+        buffer.copy_arr(reinterpret_cast<const uint16_t *>(data), count);
+        break;
+      case 4:
+        buffer.copy_arr(reinterpret_cast<const uint32_t *>(data), count);
+        break;
+      case 8:
+        buffer.copy_arr(reinterpret_cast<const uint64_t *>(data), count);
+        break;
+      default:
+        throw std::logic_error("This should not be reachable");
+    }
+  }
+
+  static void copy(
+    CDRDeserializationBuffer & buffer, uint8_t * data, size_t width, size_t count)
+  {
+    switch (width) {
+      case 1:
+        buffer.copy_arr(data, count);
+        break;
+      case 2:
+        buffer.copy_arr(reinterpret_cast<uint16_t *>(data), count);
+        break;
+      case 4:
+        buffer.copy_arr(reinterpret_cast<uint32_t *>(data), count);
+        break;
+      case 8:
+        buffer.copy_arr(reinterpret_cast<uint64_t *>(data), count);
+        break;
+      default:
+        throw std::logic_error("This should not be reachable");
+    }
+  }
+
+  void serialize_fields(
+    CDRSerializationBuffer & buffer,
+    MessageSerializer & serializer,
+    const uint8_t * input) const
+  {
+    for (const auto & op : ops) {
+      switch (op.kind) {
+        case OpKind::COPY:
+          copy(buffer, input + op.offset, op.width, op.count);
+          break;
+        case OpKind::MEMBER:
+          serializer.serialize_member(op.member, input + op.offset);
+          break;
+        case OpKind::STRUCT_ARRAY:
+          serialize_struct_array(buffer, serializer, op, input + op.offset);
+          break;
+      }
+    }
+  }
+
+  void deserialize_fields(
+    CDRDeserializationBuffer & buffer,
+    MessageDeserializer & deserializer,
+    uint8_t * output) const
+  {
+    for (const auto & op : ops) {
+      switch (op.kind) {
+        case OpKind::COPY:
+          copy(buffer, output + op.offset, op.width, op.count);
+          break;
+        case OpKind::MEMBER:
+          deserializer.deserialize_member(op.member, output + op.offset);
+          break;
+        case OpKind::STRUCT_ARRAY:
+          deserialize_struct_array(buffer, deserializer, op, output + op.offset);
+          break;
+      }
+    }
+  }
+
+  static void serialize_struct_array(
+    CDRSerializationBuffer & buffer,
+    MessageSerializer & serializer,
+    const Op & op,
+    const uint8_t * field)
+  {
+    auto member = op.member;
+    bool is_sequence = !member->array_size_ || member->is_upper_bound_;
+    size_t count = is_sequence ? member->size_function(field) : member->array_size_;
+    if (is_sequence) {
+      buffer << static_cast<uint32_t>(count);
+    }
+    if (count == 0) {
+      return;
+    }
+
+    auto elements = is_sequence ?
+      static_cast<const uint8_t *>(member->get_const_function(field, 0)) : field;
+    const MessageSerializationPlan & element_plan = *op.element_plan;
+    if (element_plan.is_dense()) {
+      const Op & run = element_plan.ops[0];
+      copy(buffer, elements, run.width, run.count * count);
+      return;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+      element_plan.serialize_fields(buffer, serializer, elements + i * element_plan.size_of);
+    }
+  }
+
+  static void deserialize_struct_array(
+    CDRDeserializationBuffer & buffer,
+    MessageDeserializer & deserializer,
+    const Op & op,
+    uint8_t * field)
+  {
+    auto member = op.member;
+    bool is_sequence = !member->array_size_ || member->is_upper_bound_;
+    size_t count = member->array_size_;
+    if (is_sequence) {
+      uint32_t size = 0;
+      buffer >> size;
+      resize_sequence(member, field, static_cast<size_t>(size));
+      count = size;
+    }
+    if (count == 0) {
+      return;
+    }
+
+    auto elements = is_sequence ? static_cast<uint8_t *>(member->get_function(field, 0)) : field;
+    const MessageSerializationPlan & element_plan = *op.element_plan;
+    if (element_plan.is_dense()) {
+      const Op & run = element_plan.ops[0];
+      copy(buffer, elements, run.width, run.count * count);
+      return;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+      element_plan.deserialize_fields(
+        buffer, deserializer, elements + i * element_plan.size_of);
+    }
+  }
+
+  const MessageMembersT * message_members;
+  size_t size_of;
+  std::vector<Op> ops;
+};
+
+template<typename MessageMembersT>
+std::string
+_get_plan_type_name(const MessageMembersT * members)
+{
+  return std::string(members->message_namespace_) + "/" + members->message_name_;
+}
+
+template<typename MessageMembersT>
+std::shared_ptr<SerializationPlan>
+_get_cached_serialization_plan(const MessageMembersT * members)
+{
+  // Plans are immutable once compiled, so every entity and serialization of a type shares one.
+  // The type name is kept to detect a type support library that was unloaded and replaced.
+  struct CachedPlan
+  {
+    std::string type_name;
+    std::shared_ptr<SerializationPlan> plan;
+  };
+  static std::mutex cache_mutex;
+  static std::unordered_map<const void *, CachedPlan> cache;
+
+  std::string type_name = _get_plan_type_name(members);
+  std::lock_guard<std::mutex> lock(cache_mutex);
+  auto it = cache.find(members);
+  if (it != cache.end() && it->second.type_name == type_name) {
+    return it->second.plan;
+  }
+
+  std::shared_ptr<SerializationPlan> plan =
+    std::make_shared<MessageSerializationPlan<MessageMembersT>>(members);
+  cache[members] = CachedPlan{std::move(type_name), plan};
+  return plan;
+}
+
+inline std::shared_ptr<SerializationPlan>
+create_serialization_plan(const void * untyped_members, const char * identifier)
+{
+  if (untyped_members == nullptr) {
+    RMW_SET_ERROR_MSG("Members handle is null");
+    return nullptr;
+  }
+
+  try {
+    if (identifier == rosidl_typesupport_introspection_c__identifier) {
+      return _get_cached_serialization_plan(
+        static_cast<const rosidl_typesupport_introspection_c__MessageMembers *>(untyped_members));
+    } else if (identifier == rosidl_typesupport_introspection_cpp::typesupport_identifier) {
+      return _get_cached_serialization_plan(
+        static_cast<const rosidl_typesupport_introspection_cpp::MessageMembers *>(
+          untyped_members));
+    }
+  } catch (std::bad_alloc &) {
+    RMW_SET_ERROR_MSG("Failed to allocate serialization plan");
+    return nullptr;
+  }
+
+  RMW_SET_ERROR_MSG("Unknown typesupport identifier");
+  return nullptr;
+}
+
+#endif  // SERIALIZATION_PLAN_HPP_
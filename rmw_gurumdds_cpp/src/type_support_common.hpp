@@ -20,8 +20,10 @@
 typedef SSIZE_T ssize_t;
 #endif
 
+#include <new>
 #include <string>
 #include <sstream>
+#include <vector>
 
 #include "rmw/allocators.h"
 #include "rmw/error_handling.h"
@@ -38,6 +40,7 @@ typedef SSIZE_T ssize_t;
 #include "rosidl_typesupport_introspection_cpp/service_introspection.hpp"
 
 #include "message_converter.hpp"
+#include "serialization_plan.hpp"
 
 template<typename MessageMembersT>
 std::string
@@ -232,133 +235,139 @@ create_metastring(const void * untyped_members, const char * identifier)
 }
 
 template<typename MessageMembersT>
-void *
-_allocate_message(
+ssize_t
+_get_serialized_size(
   const void * untyped_members,
-  const uint8_t * ros_message,
-  size_t * size,
-  bool is_service)
+  const uint8_t * ros_message)
 {
   auto members =
     static_cast<const MessageMembersT *>(untyped_members);
   if (members == nullptr) {
     RMW_SET_ERROR_MSG("Members handle is null");
-    return nullptr;
+    return -1;
   }
 
   if (ros_message == nullptr) {
     RMW_SET_ERROR_MSG("ros message is null");
-    return nullptr;
-  }
-
-  if (size == nullptr) {
-    RMW_SET_ERROR_MSG("size pointer is null");
-    return nullptr;
+    return -1;
   }
 
   auto buffer = CDRSerializationBuffer(nullptr, 0);
   auto serializer = MessageSerializer(buffer);
   serializer.serialize(members, ros_message, true);
-  if (is_service) {
-    uint64_t dummy = 0;
-    buffer << dummy;  // client_guid_0
-    buffer << dummy;  // client_guid_1
-    buffer << dummy;  // sequence_number
-    buffer << dummy;  // padding
-  }
 
-  *size = buffer.get_offset() + 4;
-  void * message = calloc(1, *size);
-  if (message == nullptr) {
-    RMW_SET_ERROR_MSG("Failed to allocate memory for dds message");
-    return nullptr;
-  }
-
-  return message;
+  return static_cast<ssize_t>(buffer.get_offset() + 4);
 }
 
-inline void *
-allocate_message(
+inline ssize_t
+get_serialized_size(
   const void * untyped_members,
   const char * identifier,
-  const void * ros_message,
-  size_t * size,
-  bool is_service)
+  const void * ros_message)
 {
   if (identifier == rosidl_typesupport_introspection_c__identifier) {
-    return _allocate_message<rosidl_typesupport_introspection_c__MessageMembers>(
+    return _get_serialized_size<rosidl_typesupport_introspection_c__MessageMembers>(
       untyped_members,
-      reinterpret_cast<const uint8_t *>(ros_message),
-      size,
-      is_service
+      reinterpret_cast<const uint8_t *>(ros_message)
     );
   } else if (identifier == rosidl_typesupport_introspection_cpp::typesupport_identifier) {
-    return _allocate_message<rosidl_typesupport_introspection_cpp::MessageMembers>(
+    return _get_serialized_size<rosidl_typesupport_introspection_cpp::MessageMembers>(
       untyped_members,
-      reinterpret_cast<const uint8_t *>(ros_message),
-      size,
-      is_service
+      reinterpret_cast<const uint8_t *>(ros_message)
     );
   }
 
   RMW_SET_ERROR_MSG("Unknown typesupport identifier");
-  return nullptr;
+  return -1;
 }
 
 template<typename MessageMembersT>
-ssize_t
-_get_serialized_size(
+bool
+_serialize_ros_to_cdr(
   const void * untyped_members,
-  const uint8_t * ros_message)
+  const uint8_t * ros_message,
+  std::vector<uint8_t> & dds_message,
+  size_t * size,
+  const SerializationPlan * plan)
 {
   auto members =
     static_cast<const MessageMembersT *>(untyped_members);
   if (members == nullptr) {
     RMW_SET_ERROR_MSG("Members handle is null");
-    return -1;
+    return false;
   }
 
   if (ros_message == nullptr) {
     RMW_SET_ERROR_MSG("ros message is null");
-    return -1;
+    return false;
   }
 
-  auto buffer = CDRSerializationBuffer(nullptr, 0);
-  auto serializer = MessageSerializer(buffer);
-  serializer.serialize(members, ros_message, true);
+  if (size == nullptr) {
+    RMW_SET_ERROR_MSG("size pointer is null");
+    return false;
+  }
 
-  return static_cast<ssize_t>(buffer.get_offset() + 4);
+  try {
+    auto buffer = CDRSerializationBuffer(dds_message);
+    if (plan != nullptr) {
+      plan->serialize(buffer, ros_message);
+    } else {
+      auto serializer = MessageSerializer(buffer);
+      serializer.serialize(members, ros_message, true);
+    }
+    *size = buffer.get_offset() + CDR_HEADER_SIZE;
+  } catch (std::runtime_error & e) {
+    RMW_SET_ERROR_MSG_WITH_FORMAT_STRING("Failed to serialize ros message: %s", e.what());
+    return false;
+  } catch (std::bad_alloc &) {
+    RMW_SET_ERROR_MSG("Failed to allocate memory for dds message");
+    return false;
+  }
+
+  return true;
 }
 
-inline ssize_t
-get_serialized_size(
+inline bool
+serialize_ros_to_cdr(
   const void * untyped_members,
   const char * identifier,
-  const void * ros_message)
+  const void * ros_message,
+  std::vector<uint8_t> & dds_message,
+  size_t * size,
+  const SerializationPlan * plan = nullptr)
 {
   if (identifier == rosidl_typesupport_introspection_c__identifier) {
-    return _get_serialized_size<rosidl_typesupport_introspection_c__MessageMembers>(
+    return _serialize_ros_to_cdr<rosidl_typesupport_introspection_c__MessageMembers>(
       untyped_members,
-      reinterpret_cast<const uint8_t *>(ros_message)
+      reinterpret_cast<const uint8_t *>(ros_message),
+      dds_message,
+      size,
+      plan
     );
   } else if (identifier == rosidl_typesupport_introspection_cpp::typesupport_identifier) {
-    return _get_serialized_size<rosidl_typesupport_introspection_cpp::MessageMembers>(
+    return _serialize_ros_to_cdr<rosidl_typesupport_introspection_cpp::MessageMembers>(
       untyped_members,
-      reinterpret_cast<const uint8_t *>(ros_message)
+      reinterpret_cast<const uint8_t *>(ros_message),
+      dds_message,
+      size,
+      plan
     );
   }
 
   RMW_SET_ERROR_MSG("Unknown typesupport identifier");
-  return -1;
+  return false;
 }
 
+// Serializes into a caller provided buffer, which fails instead of growing when it is too small
 template<typename MessageMembersT>
 bool
 _serialize_ros_to_cdr(
   const void * untyped_members,
   const uint8_t * ros_message,
   uint8_t * dds_message,
-  const size_t size)
+  size_t capacity,
+  size_t * size,
+  const SerializationPlan * plan)
 {
   auto members =
     static_cast<const MessageMembersT *>(untyped_members);
@@ -367,10 +376,25 @@ _serialize_ros_to_cdr(
     return false;
   }
 
+  if (ros_message == nullptr) {
+    RMW_SET_ERROR_MSG("ros message is null");
+    return false;
+  }
+
+  if (size == nullptr) {
+    RMW_SET_ERROR_MSG("size pointer is null");
+    return false;
+  }
+
   try {
-    auto buffer = CDRSerializationBuffer(dds_message, size);
-    auto serializer = MessageSerializer(buffer);
-    serializer.serialize(members, ros_message, true);
+    auto buffer = CDRSerializationBuffer(dds_message, capacity);
+    if (plan != nullptr) {
+      plan->serialize(buffer, ros_message);
+    } else {
+      auto serializer = MessageSerializer(buffer);
+      serializer.serialize(members, ros_message, true);
+    }
+    *size = buffer.get_offset() + CDR_HEADER_SIZE;
   } catch (std::runtime_error & e) {
     RMW_SET_ERROR_MSG_WITH_FORMAT_STRING("Failed to serialize ros message: %s", e.what());
     return false;
@@ -384,22 +408,28 @@ serialize_ros_to_cdr(
   const void * untyped_members,
   const char * identifier,
   const void * ros_message,
-  void * dds_message,
-  const size_t size)
+  uint8_t * dds_message,
+  size_t capacity,
+  size_t * size,
+  const SerializationPlan * plan = nullptr)
 {
   if (identifier == rosidl_typesupport_introspection_c__identifier) {
     return _serialize_ros_to_cdr<rosidl_typesupport_introspection_c__MessageMembers>(
       untyped_members,
       reinterpret_cast<const uint8_t *>(ros_message),
-      reinterpret_cast<uint8_t *>(dds_message),
-      size
+      dds_message,
+      capacity,
+      size,
+      plan
     );
   } else if (identifier == rosidl_typesupport_introspection_cpp::typesupport_identifier) {
     return _serialize_ros_to_cdr<rosidl_typesupport_introspection_cpp::MessageMembers>(
       untyped_members,
       reinterpret_cast<const uint8_t *>(ros_message),
-      reinterpret_cast<uint8_t *>(dds_message),
-      size
+      dds_message,
+      capacity,
+      size,
+      plan
     );
   }
 
@@ -413,7 +443,8 @@ _deserialize_cdr_to_ros(
   const void * untyped_members,
   uint8_t * ros_message,
   uint8_t * dds_message,
-  const size_t size)
+  const size_t size,
+  const SerializationPlan * plan)
 {
   auto members =
     static_cast<const MessageMembersT *>(untyped_members);
@@ -424,8 +455,12 @@ _deserialize_cdr_to_ros(
 
   try {
     auto buffer = CDRDeserializationBuffer(dds_message, size);
-    auto deserializer = MessageDeserializer(buffer);
-    deserializer.deserialize(members, ros_message);
+    if (plan != nullptr) {
+      plan->deserialize(buffer, ros_message);
+    } else {
+      auto deserializer = MessageDeserializer(buffer);
+      deserializer.deserialize(members, ros_message);
+    }
   } catch (std::runtime_error & e) {
     RMW_SET_ERROR_MSG_WITH_FORMAT_STRING("Failed to deserialize dds message: %s", e.what());
     return false;
@@ -440,21 +475,24 @@ deserialize_cdr_to_ros(
   const char * identifier,
   void * ros_message,
   void * dds_message,
-  const size_t size)
+  const size_t size,
+  const SerializationPlan * plan = nullptr)
 {
   if (identifier == rosidl_typesupport_introspection_c__identifier) {
     return _deserialize_cdr_to_ros<rosidl_typesupport_introspection_c__MessageMembers>(
       untyped_members,
       reinterpret_cast<uint8_t *>(ros_message),
       reinterpret_cast<uint8_t *>(dds_message),
-      size
+      size,
+      plan
     );
   } else if (identifier == rosidl_typesupport_introspection_cpp::typesupport_identifier) {
     return _deserialize_cdr_to_ros<rosidl_typesupport_introspection_cpp::MessageMembers>(
       untyped_members,
       reinterpret_cast<uint8_t *>(ros_message),
       reinterpret_cast<uint8_t *>(dds_message),
-      size
+      size,
+      plan
     );
   }
 
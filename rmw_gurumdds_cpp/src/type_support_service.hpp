@@ -17,6 +17,7 @@
 
 #include <string>
 #include <utility>
+#include <vector>
 
 #include "type_support_common.hpp"
 
@@ -95,197 +96,13 @@ create_service_metastring(const void * untyped_members, const char * identifier)
   return {"", ""};
 }
 
-template<typename ServiceMembersT>
-void *
-_allocate_request_basic(
-  const void * untyped_members,
-  const void * ros_request,
-  size_t * size)
-{
-  auto members = static_cast<const ServiceMembersT *>(untyped_members);
-  if (members == nullptr) {
-    RMW_SET_ERROR_MSG("Members handle is null");
-    return nullptr;
-  }
-
-  return _allocate_message<GET_TYPENAME(members->request_members_)>(
-    static_cast<const void *>(members->request_members_),
-    static_cast<const uint8_t *>(ros_request),
-    size,
-    true
-  );
-}
-
-inline void *
-allocate_request_basic(
-  const void * untyped_members,
-  const char * identifier,
-  const void * ros_request,
-  size_t * size)
-{
-  if (identifier == rosidl_typesupport_introspection_c__identifier) {
-    return _allocate_request_basic<rosidl_typesupport_introspection_c__ServiceMembers>(
-      untyped_members,
-      reinterpret_cast<const uint8_t *>(ros_request),
-      size
-    );
-  } else if (identifier == rosidl_typesupport_introspection_cpp::typesupport_identifier) {
-    return _allocate_request_basic<rosidl_typesupport_introspection_cpp::ServiceMembers>(
-      untyped_members,
-      reinterpret_cast<const uint8_t *>(ros_request),
-      size
-    );
-  }
-
-  RMW_SET_ERROR_MSG("Unknown typesupport identifier");
-  return nullptr;
-}
-
-template<typename ServiceMembersT>
-void *
-_allocate_response_basic(
-  const void * untyped_members,
-  const void * ros_response,
-  size_t * size)
-{
-  auto members = static_cast<const ServiceMembersT *>(untyped_members);
-  if (members == nullptr) {
-    RMW_SET_ERROR_MSG("Members handle is null");
-    return nullptr;
-  }
-
-  return _allocate_message<GET_TYPENAME(members->response_members_)>(
-    static_cast<const void *>(members->response_members_),
-    static_cast<const uint8_t *>(ros_response),
-    size,
-    true
-  );
-}
-
-inline void *
-allocate_response_basic(
-  const void * untyped_members,
-  const char * identifier,
-  const void * ros_response,
-  size_t * size)
-{
-  if (identifier == rosidl_typesupport_introspection_c__identifier) {
-    return _allocate_response_basic<rosidl_typesupport_introspection_c__ServiceMembers>(
-      untyped_members,
-      reinterpret_cast<const uint8_t *>(ros_response),
-      size
-    );
-  } else if (identifier == rosidl_typesupport_introspection_cpp::typesupport_identifier) {
-    return _allocate_response_basic<rosidl_typesupport_introspection_cpp::ServiceMembers>(
-      untyped_members,
-      reinterpret_cast<const uint8_t *>(ros_response),
-      size
-    );
-  }
-
-  RMW_SET_ERROR_MSG("Unknown typesupport identifier");
-  return nullptr;
-}
-
-template<typename ServiceMembersT>
-void *
-_allocate_request_enhanced(
-  const void * untyped_members,
-  const void * ros_request,
-  size_t * size)
-{
-  auto members = static_cast<const ServiceMembersT *>(untyped_members);
-  if (members == nullptr) {
-    RMW_SET_ERROR_MSG("Members handle is null");
-    return nullptr;
-  }
-
-  return _allocate_message<GET_TYPENAME(members->request_members_)>(
-    static_cast<const void *>(members->request_members_),
-    static_cast<const uint8_t *>(ros_request),
-    size,
-    false
-  );
-}
-
-inline void *
-allocate_request_enhanced(
-  const void * untyped_members,
-  const char * identifier,
-  const void * ros_request,
-  size_t * size)
-{
-  if (identifier == rosidl_typesupport_introspection_c__identifier) {
-    return _allocate_request_enhanced<rosidl_typesupport_introspection_c__ServiceMembers>(
-      untyped_members,
-      reinterpret_cast<const uint8_t *>(ros_request),
-      size
-    );
-  } else if (identifier == rosidl_typesupport_introspection_cpp::typesupport_identifier) {
-    return _allocate_request_enhanced<rosidl_typesupport_introspection_cpp::ServiceMembers>(
-      untyped_members,
-      reinterpret_cast<const uint8_t *>(ros_request),
-      size
-    );
-  }
-
-  RMW_SET_ERROR_MSG("Unknown typesupport identifier");
-  return nullptr;
-}
-
-template<typename ServiceMembersT>
-void *
-_allocate_response_enhanced(
-  const void * untyped_members,
-  const void * ros_response,
-  size_t * size)
-{
-  auto members = static_cast<const ServiceMembersT *>(untyped_members);
-  if (members == nullptr) {
-    RMW_SET_ERROR_MSG("Members handle is null");
-    return nullptr;
-  }
-
-  return _allocate_message<GET_TYPENAME(members->response_members_)>(
-    static_cast<const void *>(members->response_members_),
-    static_cast<const uint8_t *>(ros_response),
-    size,
-    false
-  );
-}
-
-inline void *
-allocate_response_enhanced(
-  const void * untyped_members,
-  const char * identifier,
-  const void * ros_response,
-  size_t * size)
-{
-  if (identifier == rosidl_typesupport_introspection_c__identifier) {
-    return _allocate_response_enhanced<rosidl_typesupport_introspection_c__ServiceMembers>(
-      untyped_members,
-      reinterpret_cast<const uint8_t *>(ros_response),
-      size
-    );
-  } else if (identifier == rosidl_typesupport_introspection_cpp::typesupport_identifier) {
-    return _allocate_response_enhanced<rosidl_typesupport_introspection_cpp::ServiceMembers>(
-      untyped_members,
-      reinterpret_cast<const uint8_t *>(ros_response),
-      size
-    );
-  }
-
-  RMW_SET_ERROR_MSG("Unknown typesupport identifier");
-  return nullptr;
-}
-
 template<typename MessageMembersT>
 bool
 _serialize_service_basic(
   const void * untyped_members,
   const uint8_t * ros_service,
-  uint8_t * dds_service,
-  size_t size,
+  std::vector<uint8_t> & dds_service,
+  size_t * size,
   int64_t sequence_number,
   const uint8_t * client_guid,
   bool is_request)
@@ -301,7 +118,7 @@ _serialize_service_basic(
   uint32_t sn_low = static_cast<uint32_t>(sequence_number & 0x00000000FFFFFFFFLL);
 
   try {
-    auto buffer = CDRSerializationBuffer(dds_service, size);
+    auto buffer = CDRSerializationBuffer(dds_service);
     auto serializer = MessageSerializer(buffer);
     buffer << *(reinterpret_cast<const uint64_t *>(client_guid));
     buffer << *(reinterpret_cast<const uint64_t *>(client_guid + 8));
@@ -315,9 +132,13 @@ _serialize_service_basic(
       buffer << *(reinterpret_cast<uint32_t *>(&remoteEx));
     }
     serializer.serialize(members, ros_service, true);
+    *size = buffer.get_offset() + CDR_HEADER_SIZE;
   } catch (std::runtime_error & e) {
     RMW_SET_ERROR_MSG_WITH_FORMAT_STRING("Failed to serialize ros message: %s", e.what());
     return false;
+  } catch (std::bad_alloc &) {
+    RMW_SET_ERROR_MSG("Failed to allocate memory for dds message");
+    return false;
   }
 
   return true;
@@ -328,8 +149,8 @@ serialize_service_basic(
   const void * untyped_members,
   const char * identifier,
   const void * ros_service,
-  void * dds_service,
-  size_t size,
+  std::vector<uint8_t> & dds_service,
+  size_t * size,
   int64_t sequence_number,
   const uint8_t * client_guid,
   bool is_request)
@@ -338,7 +159,7 @@ serialize_service_basic(
     return _serialize_service_basic<rosidl_typesupport_introspection_c__MessageMembers>(
       untyped_members,
       reinterpret_cast<const uint8_t *>(ros_service),
-      reinterpret_cast<uint8_t *>(dds_service),
+      dds_service,
       size,
       sequence_number,
       client_guid,
@@ -348,7 +169,7 @@ serialize_service_basic(
     return _serialize_service_basic<rosidl_typesupport_introspection_cpp::MessageMembers>(
       untyped_members,
       reinterpret_cast<const uint8_t *>(ros_service),
-      reinterpret_cast<uint8_t *>(dds_service),
+      dds_service,
       size,
       sequence_number,
       client_guid,
@@ -365,8 +186,8 @@ bool
 _serialize_request_basic(
   const void * untyped_members,
   const uint8_t * ros_request,
-  uint8_t * dds_request,
-  size_t size,
+  std::vector<uint8_t> & dds_request,
+  size_t * size,
   int64_t sequence_number,
   const uint8_t * client_guid)
 {
@@ -392,8 +213,8 @@ serialize_request_basic(
   const void * untyped_members,
   const char * identifier,
   const void * ros_request,
-  void * dds_request,
-  size_t size,
+  std::vector<uint8_t> & dds_request,
+  size_t * size,
   int64_t sequence_number,
   const uint8_t * client_guid)
 {
@@ -401,7 +222,7 @@ serialize_request_basic(
     return _serialize_request_basic<rosidl_typesupport_introspection_c__ServiceMembers>(
       untyped_members,
       reinterpret_cast<const uint8_t *>(ros_request),
-      reinterpret_cast<uint8_t *>(dds_request),
+      dds_request,
       size,
       sequence_number,
       client_guid
@@ -410,7 +231,7 @@ serialize_request_basic(
     return _serialize_request_basic<rosidl_typesupport_introspection_cpp::ServiceMembers>(
       untyped_members,
       reinterpret_cast<const uint8_t *>(ros_request),
-      reinterpret_cast<uint8_t *>(dds_request),
+      dds_request,
       size,
       sequence_number,
       client_guid
@@ -426,8 +247,8 @@ bool
 _serialize_response_basic(
   const void * untyped_members,
   const uint8_t * ros_response,
-  uint8_t * dds_response,
-  size_t size,
+  std::vector<uint8_t> & dds_response,
+  size_t * size,
   int64_t sequence_number,
   const uint8_t * client_guid)
 {
@@ -453,8 +274,8 @@ serialize_response_basic(
   const void * untyped_members,
   const char * identifier,
   const void * ros_response,
-  void * dds_response,
-  size_t size,
+  std::vector<uint8_t> & dds_response,
+  size_t * size,
   int64_t sequence_number,
   const uint8_t * client_guid)
 {
@@ -462,7 +283,7 @@ serialize_response_basic(
     return _serialize_response_basic<rosidl_typesupport_introspection_c__ServiceMembers>(
       untyped_members,
       reinterpret_cast<const uint8_t *>(ros_response),
-      reinterpret_cast<uint8_t *>(dds_response),
+      dds_response,
       size,
       sequence_number,
       client_guid
@@ -471,7 +292,7 @@ serialize_response_basic(
     return _serialize_response_basic<rosidl_typesupport_introspection_cpp::ServiceMembers>(
       untyped_members,
       reinterpret_cast<const uint8_t *>(ros_response),
-      reinterpret_cast<uint8_t *>(dds_response),
+      dds_response,
       size,
       sequence_number,
       client_guid
@@ -487,8 +308,8 @@ bool
 _serialize_service_enhanced(
   const void * untyped_members,
   const uint8_t * ros_service,
-  uint8_t * dds_service,
-  size_t size)
+  std::vector<uint8_t> & dds_service,
+  size_t * size)
 {
   auto members =
     static_cast<const MessageMembersT *>(untyped_members);
@@ -498,12 +319,16 @@ _serialize_service_enhanced(
   }
 
   try {
-    auto buffer = CDRSerializationBuffer(dds_service, size);
+    auto buffer = CDRSerializationBuffer(dds_service);
     auto serializer = MessageSerializer(buffer);
     serializer.serialize(members, ros_service, true);
+    *size = buffer.get_offset() + CDR_HEADER_SIZE;
   } catch (std::runtime_error & e) {
     RMW_SET_ERROR_MSG_WITH_FORMAT_STRING("Failed to serialize ros message: %s", e.what());
     return false;
+  } catch (std::bad_alloc &) {
+    RMW_SET_ERROR_MSG("Failed to allocate memory for dds message");
+    return false;
   }
 
   return true;
@@ -514,21 +339,21 @@ serialize_service_enhanced(
   const void * untyped_members,
   const char * identifier,
   const void * ros_service,
-  void * dds_service,
-  size_t size)
+  std::vector<uint8_t> & dds_service,
+  size_t * size)
 {
   if (identifier == rosidl_typesupport_introspection_c__identifier) {
     return _serialize_service_enhanced<rosidl_typesupport_introspection_c__MessageMembers>(
       untyped_members,
       reinterpret_cast<const uint8_t *>(ros_service),
-      reinterpret_cast<uint8_t *>(dds_service),
+      dds_service,
       size
     );
   } else if (identifier == rosidl_typesupport_introspection_cpp::typesupport_identifier) {
     return _serialize_service_enhanced<rosidl_typesupport_introspection_cpp::MessageMembers>(
       untyped_members,
       reinterpret_cast<const uint8_t *>(ros_service),
-      reinterpret_cast<uint8_t *>(dds_service),
+      dds_service,
       size
     );
   }
@@ -542,8 +367,8 @@ bool
 _serialize_request_enhanced(
   const void * untyped_members,
   const uint8_t * ros_request,
-  uint8_t * dds_request,
-  size_t size)
+  std::vector<uint8_t> & dds_request,
+  size_t * size)
 {
   auto members = static_cast<const ServiceMembersT *>(untyped_members);
   if (members == nullptr) {
@@ -564,21 +389,21 @@ serialize_request_enhanced(
   const void * untyped_members,
   const char * identifier,
   const void * ros_request,
-  void * dds_request,
-  size_t size)
+  std::vector<uint8_t> & dds_request,
+  size_t * size)
 {
   if (identifier == rosidl_typesupport_introspection_c__identifier) {
     return _serialize_request_enhanced<rosidl_typesupport_introspection_c__ServiceMembers>(
       untyped_members,
       reinterpret_cast<const uint8_t *>(ros_request),
-      reinterpret_cast<uint8_t *>(dds_request),
+      dds_request,
       size
     );
   } else if (identifier == rosidl_typesupport_introspection_cpp::typesupport_identifier) {
     return _serialize_request_enhanced<rosidl_typesupport_introspection_cpp::ServiceMembers>(
       untyped_members,
       reinterpret_cast<const uint8_t *>(ros_request),
-      reinterpret_cast<uint8_t *>(dds_request),
+      dds_request,
       size
     );
   }
@@ -592,8 +417,8 @@ bool
 _serialize_response_enhanced(
   const void * untyped_members,
   const uint8_t * ros_response,
-  uint8_t * dds_response,
-  size_t size)
+  std::vector<uint8_t> & dds_response,
+  size_t * size)
 {
   auto members = static_cast<const ServiceMembersT *>(untyped_members);
   if (members == nullptr) {
@@ -614,21 +439,21 @@ serialize_response_enhanced(
   const void * untyped_members,
   const char * identifier,
   const void * ros_response,
-  void * dds_response,
-  size_t size)
+  std::vector<uint8_t> & dds_response,
+  size_t * size)
 {
   if (identifier == rosidl_typesupport_introspection_c__identifier) {
     return _serialize_response_enhanced<rosidl_typesupport_introspection_c__ServiceMembers>(
       untyped_members,
       reinterpret_cast<const uint8_t *>(ros_response),
-      reinterpret_cast<uint8_t *>(dds_response),
+      dds_response,
       size
     );
   } else if (identifier == rosidl_typesupport_introspection_cpp::typesupport_identifier) {
     return _serialize_response_enhanced<rosidl_typesupport_introspection_cpp::ServiceMembers>(
       untyped_members,
       reinterpret_cast<const uint8_t *>(ros_response),
-      reinterpret_cast<uint8_t *>(dds_response),
+      dds_response,
       size
     );
   }
@@ -679,6 +504,49 @@ _deserialize_service_basic(
   return true;
 }
 
+// Reads the client GUID that leads every sample of the basic mapping, without deserializing
+// the rest of the sample.
+inline bool
+peek_service_basic_guid(void * dds_service, size_t size, uint8_t * client_guid)
+{
+  try {
+    auto buffer = CDRDeserializationBuffer(reinterpret_cast<uint8_t *>(dds_service), size);
+    buffer >> *(reinterpret_cast<uint64_t *>(client_guid));
+    buffer >> *(reinterpret_cast<uint64_t *>(client_guid + 8));
+  } catch (std::runtime_error & e) {
+    RMW_SET_ERROR_MSG_WITH_FORMAT_STRING("Failed to deserialize dds message: %s", e.what());
+    return false;
+  }
+
+  return true;
+}
+
+// Reads the client GUID and sequence number that lead every sample of the basic mapping,
+// without deserializing the rest of the sample.
+inline bool
+peek_service_basic_header(
+  void * dds_service,
+  size_t size,
+  uint8_t * client_guid,
+  int64_t * sequence_number)
+{
+  try {
+    auto buffer = CDRDeserializationBuffer(reinterpret_cast<uint8_t *>(dds_service), size);
+    int32_t sn_high = 0;
+    uint32_t sn_low = 0;
+    buffer >> *(reinterpret_cast<uint64_t *>(client_guid));
+    buffer >> *(reinterpret_cast<uint64_t *>(client_guid + 8));
+    buffer >> *(reinterpret_cast<uint32_t *>(&sn_high));
+    buffer >> sn_low;
+    *sequence_number = ((int64_t)sn_high) << 32 | sn_low;
+  } catch (std::runtime_error & e) {
+    RMW_SET_ERROR_MSG_WITH_FORMAT_STRING("Failed to deserialize dds message: %s", e.what());
+    return false;
+  }
+
+  return true;
+}
+
 inline bool
 deserialize_service_basic(
   const void * untyped_members,
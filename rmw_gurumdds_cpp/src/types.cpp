@@ -12,6 +12,10 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <algorithm>
+#include <new>
+#include <system_error>
+
 #include "rmw/impl/cpp/key_value.hpp"
 
 #include "rmw_gurumdds_cpp/event_converter.hpp"
@@ -65,6 +69,8 @@ rmw_ret_t GurumddsPublisherInfo::get_status(
     rmw_status->total_count = status.total_count;
     rmw_status->total_count_change = status.total_count_change;
     rmw_status->last_policy_kind = convert_qos_policy(status.last_policy_id);
+  } else if (mask == dds_PUBLICATION_MATCHED_STATUS) {
+    this->matched_subscriptions.take(static_cast<rmw_matched_status_t *>(event));
   } else {
     return RMW_RET_UNSUPPORTED;
   }
@@ -78,7 +84,16 @@ dds_StatusCondition * GurumddsPublisherInfo::get_statuscondition()
 
 dds_StatusMask GurumddsPublisherInfo::get_status_changes()
 {
-  return dds_DataWriter_get_status_changes(this->topic_writer);
+  dds_StatusMask mask = dds_DataWriter_get_status_changes(this->topic_writer);
+  if (this->matched_subscriptions.has_changes()) {
+    mask |= dds_PUBLICATION_MATCHED_STATUS;
+  }
+  return mask;
+}
+
+GurumddsMatchedStatus * GurumddsPublisherInfo::get_matched_status()
+{
+  return &this->matched_subscriptions;
 }
 
 rmw_ret_t GurumddsSubscriberInfo::get_status(
@@ -138,6 +153,8 @@ rmw_ret_t GurumddsSubscriberInfo::get_status(
     auto rmw_status = static_cast<rmw_message_lost_status_t *>(event);
     rmw_status->total_count = status.total_count;
     rmw_status->total_count_change = status.total_count_change;
+  } else if (mask == dds_SUBSCRIPTION_MATCHED_STATUS) {
+    this->matched_publications.take(static_cast<rmw_matched_status_t *>(event));
   } else {
     return RMW_RET_UNSUPPORTED;
   }
@@ -151,7 +168,303 @@ dds_StatusCondition * GurumddsSubscriberInfo::get_statuscondition()
 
 dds_StatusMask GurumddsSubscriberInfo::get_status_changes()
 {
-  return dds_DataReader_get_status_changes(this->topic_reader);
+  dds_StatusMask mask = dds_DataReader_get_status_changes(this->topic_reader);
+  if (this->matched_publications.has_changes()) {
+    mask |= dds_SUBSCRIPTION_MATCHED_STATUS;
+  }
+  return mask;
+}
+
+GurumddsMatchedStatus * GurumddsSubscriberInfo::get_matched_status()
+{
+  return &this->matched_publications;
+}
+
+void _GurumddsEventInfo::set_wait_set_statuses(const void * wait_set, dds_StatusMask mask)
+{
+  std::lock_guard<std::mutex> lock(wait_set_statuses_mutex);
+  auto it = std::find_if(
+    wait_set_statuses.begin(), wait_set_statuses.end(),
+    [wait_set](const std::pair<const void *, dds_StatusMask> & entry) {
+      return entry.first == wait_set;
+    });
+  if (it == wait_set_statuses.end()) {
+    if (mask != 0) {
+      wait_set_statuses.emplace_back(wait_set, mask);
+    }
+  } else if (mask != 0) {
+    it->second = mask;
+  } else {
+    wait_set_statuses.erase(it);
+  }
+
+  dds_StatusMask statuses = 0;
+  for (const auto & entry : wait_set_statuses) {
+    statuses |= entry.second;
+  }
+  if (enabled_statuses_applied && statuses == enabled_statuses) {
+    return;
+  }
+  dds_StatusCondition_set_enabled_statuses(get_statuscondition(), statuses);
+  enabled_statuses = statuses;
+  enabled_statuses_applied = true;
+}
+
+_GurumddsTakeSequences::~_GurumddsTakeSequences()
+{
+  fini();
+}
+
+bool _GurumddsTakeSequences::init(uint32_t a_length)
+{
+  data_values = dds_DataSeq_create(a_length);
+  sample_infos = dds_SampleInfoSeq_create(a_length);
+  sample_sizes = dds_UnsignedLongSeq_create(a_length);
+  if (data_values == nullptr || sample_infos == nullptr || sample_sizes == nullptr) {
+    fini();
+    return false;
+  }
+
+  length = a_length;
+  return true;
+}
+
+void _GurumddsTakeSequences::fini()
+{
+  length = 0;
+
+  if (data_values != nullptr) {
+    dds_DataSeq_delete(data_values);
+    data_values = nullptr;
+  }
+
+  if (sample_infos != nullptr) {
+    dds_SampleInfoSeq_delete(sample_infos);
+    sample_infos = nullptr;
+  }
+
+  if (sample_sizes != nullptr) {
+    dds_UnsignedLongSeq_delete(sample_sizes);
+    sample_sizes = nullptr;
+  }
+}
+
+TakeSequencesGuard::TakeSequencesGuard(GurumddsTakeSequences & shared)
+: length(0),
+  data_values(nullptr),
+  sample_infos(nullptr),
+  sample_sizes(nullptr),
+  lock(shared.mutex, std::try_to_lock)
+{
+  GurumddsTakeSequences * sequences = &shared;
+  if (!lock.owns_lock() || shared.data_values == nullptr) {
+    if (lock.owns_lock()) {
+      lock.unlock();
+    }
+    if (!temporary.init(shared.length > 0 ? shared.length : 1)) {
+      return;
+    }
+    sequences = &temporary;
+  }
+
+  length = sequences->length;
+  data_values = sequences->data_values;
+  sample_infos = sequences->sample_infos;
+  sample_sizes = sequences->sample_sizes;
+}
+
+constexpr size_t GurumddsLoanPool::header_size;
+
+GurumddsLoanPool::~GurumddsLoanPool()
+{
+  for (uint8_t * block : free_blocks) {
+    delete[] block;
+  }
+}
+
+void GurumddsLoanPool::init(size_t a_message_size)
+{
+  message_size = a_message_size;
+}
+
+void * GurumddsLoanPool::acquire()
+{
+  uint8_t * block = nullptr;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!free_blocks.empty()) {
+      block = free_blocks.back();
+      free_blocks.pop_back();
+    }
+  }
+
+  if (block == nullptr) {
+    block = new(std::nothrow) uint8_t[header_size + message_size];
+    if (block == nullptr) {
+      return nullptr;
+    }
+  }
+
+  return block + header_size;
+}
+
+void GurumddsLoanPool::release(void * message)
+{
+  uint8_t * block = static_cast<uint8_t *>(message) - header_size;
+  std::lock_guard<std::mutex> lock(mutex);
+  try {
+    free_blocks.push_back(block);
+  } catch (std::bad_alloc &) {
+    delete[] block;
+  }
+}
+
+GurumddsWorkerPool::~GurumddsWorkerPool()
+{
+  shutdown();
+}
+
+void GurumddsWorkerPool::run(
+  const std::vector<std::function<void()>> & tasks, size_t thread_count)
+{
+  Batch batch{&tasks, 0, 0};
+  std::unique_lock<std::mutex> lock(mutex);
+  if (!started && !stopping) {
+    started = true;
+    try {
+      while (threads.size() + 1 < thread_count) {
+        threads.emplace_back(&GurumddsWorkerPool::work, this);
+      }
+    } catch (const std::system_error &) {
+      // The threads that did start are enough
+    }
+  }
+
+  bool shared = !threads.empty() && tasks.size() > 1;
+  if (shared) {
+    batches.push_back(&batch);
+    work_condition.notify_all();
+  }
+
+  while (run_next(lock, batch)) {
+  }
+  done_condition.wait(lock, [&batch]() {return batch.done == batch.tasks->size();});
+}
+
+bool GurumddsWorkerPool::run_next(std::unique_lock<std::mutex> & lock, Batch & batch)
+{
+  if (batch.next == batch.tasks->size()) {
+    return false;
+  }
+
+  size_t index = batch.next++;
+  if (batch.next == batch.tasks->size()) {
+    auto it = std::find(batches.begin(), batches.end(), &batch);
+    if (it != batches.end()) {
+      batches.erase(it);
+    }
+  }
+
+  lock.unlock();
+  (*batch.tasks)[index]();
+  lock.lock();
+
+  if (++batch.done == batch.tasks->size()) {
+    done_condition.notify_all();
+  }
+  return true;
+}
+
+void GurumddsWorkerPool::work()
+{
+  std::unique_lock<std::mutex> lock(mutex);
+  while (true) {
+    work_condition.wait(lock, [this]() {return stopping || !batches.empty();});
+    if (batches.empty()) {
+      return;
+    }
+    run_next(lock, *batches.front());
+  }
+}
+
+void GurumddsWorkerPool::shutdown()
+{
+  std::vector<std::thread> stopped;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+    stopped.swap(threads);
+  }
+  work_condition.notify_all();
+  for (std::thread & thread : stopped) {
+    thread.join();
+  }
+}
+
+void GurumddsEventCallback::set(rmw_event_callback_t a_callback, const void * a_user_data)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  callback = a_callback;
+  user_data = a_user_data;
+  if (callback != nullptr && unread_count > 0) {
+    callback(user_data, unread_count);
+    unread_count = 0;
+  }
+}
+
+void GurumddsEventCallback::notify(size_t count)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  if (callback != nullptr) {
+    callback(user_data, count);
+  } else {
+    unread_count += count;
+  }
+}
+
+GurumddsMatchedStatus::~GurumddsMatchedStatus()
+{
+  if (condition != nullptr) {
+    wait_sets_forget_condition(reinterpret_cast<dds_Condition *>(condition));
+    dds_GuardCondition_delete(condition);
+  }
+}
+
+bool GurumddsMatchedStatus::init()
+{
+  condition = dds_GuardCondition_create();
+  return condition != nullptr;
+}
+
+void GurumddsMatchedStatus::update(int32_t total_count, int32_t current_count)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  total = total_count;
+  current.store(current_count, std::memory_order_relaxed);
+  if (condition != nullptr && (total != taken_total || current_count != taken_current)) {
+    dds_GuardCondition_set_trigger_value(condition, true);
+  }
+}
+
+void GurumddsMatchedStatus::take(rmw_matched_status_t * status)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  const int32_t current_count = current.load(std::memory_order_relaxed);
+  status->total_count = static_cast<size_t>(total);
+  status->total_count_change = static_cast<size_t>(total - taken_total);
+  status->current_count = static_cast<size_t>(current_count);
+  status->current_count_change = current_count - taken_current;
+  taken_total = total;
+  taken_current = current_count;
+  if (condition != nullptr) {
+    dds_GuardCondition_set_trigger_value(condition, false);
+  }
+}
+
+bool GurumddsMatchedStatus::has_changes()
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  return total != taken_total || current.load(std::memory_order_relaxed) != taken_current;
 }
 
 static std::map<std::string, std::vector<uint8_t>>
@@ -0,0 +1,106 @@
+// Copyright 2019 GurumNetworks, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "rcutils/allocator.h"
+#include "rcutils/strdup.h"
+
+#include "rmw/error_handling.h"
+#include "rmw/init.h"
+#include "rmw/init_options.h"
+#include "rmw/rmw.h"
+
+class TestRmwWait : public ::testing::Test
+{
+protected:
+  void SetUp() override
+  {
+    rcutils_allocator_t allocator = rcutils_get_default_allocator();
+    ASSERT_EQ(RMW_RET_OK, rmw_init_options_init(&options, allocator)) <<
+      rmw_get_error_string().str;
+    options.enclave = rcutils_strdup("/", allocator);
+    ASSERT_NE(nullptr, options.enclave);
+    ASSERT_EQ(RMW_RET_OK, rmw_init(&options, &context)) << rmw_get_error_string().str;
+  }
+
+  void TearDown() override
+  {
+    EXPECT_EQ(RMW_RET_OK, rmw_shutdown(&context)) << rmw_get_error_string().str;
+    EXPECT_EQ(RMW_RET_OK, rmw_context_fini(&context)) << rmw_get_error_string().str;
+    EXPECT_EQ(RMW_RET_OK, rmw_init_options_fini(&options)) << rmw_get_error_string().str;
+  }
+
+  rmw_init_options_t options = rmw_get_zero_initialized_init_options();
+  rmw_context_t context = rmw_get_zero_initialized_context();
+};
+
+// Not a pass/fail check on timing; records the cost of an rmw_wait that finds one triggered
+// guard condition among count of them, so it can be compared across entity counts
+TEST_F(TestRmwWait, benchmark_wait_by_entity_count) {
+  constexpr int iterations = 200;
+  const size_t counts[] = {10, 100, 500, 1000, 2000};
+
+  for (size_t count : counts) {
+    std::vector<rmw_guard_condition_t *> guard_conditions;
+    for (size_t i = 0; i < count; i++) {
+      rmw_guard_condition_t * guard_condition = rmw_create_guard_condition(&context);
+      ASSERT_NE(nullptr, guard_condition) << rmw_get_error_string().str;
+      guard_conditions.push_back(guard_condition);
+    }
+    rmw_wait_set_t * wait_set = rmw_create_wait_set(&context, count);
+    ASSERT_NE(nullptr, wait_set) << rmw_get_error_string().str;
+
+    std::vector<void *> handles(count);
+    rmw_guard_conditions_t rmw_guard_conditions;
+    rmw_guard_conditions.guard_condition_count = count;
+    rmw_guard_conditions.guard_conditions = handles.data();
+    rmw_events_t events;
+    events.event_count = 0;
+    events.events = nullptr;
+    rmw_time_t timeout{0, 0};
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; i++) {
+      size_t triggered = static_cast<size_t>(i) % count;
+      ASSERT_EQ(RMW_RET_OK, rmw_trigger_guard_condition(guard_conditions[triggered]));
+      for (size_t j = 0; j < count; j++) {
+        handles[j] = guard_conditions[j]->data;
+      }
+
+      ASSERT_EQ(
+        RMW_RET_OK,
+        rmw_wait(nullptr, &rmw_guard_conditions, nullptr, nullptr, &events, wait_set, &timeout)) <<
+        rmw_get_error_string().str;
+      for (size_t j = 0; j < count; j++) {
+        ASSERT_EQ(j == triggered, handles[j] != nullptr);
+      }
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    int64_t wait_ns =
+      std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count() / iterations;
+    RecordProperty("wait_ns_" + std::to_string(count) + "_entities", std::to_string(wait_ns));
+
+    EXPECT_EQ(RMW_RET_OK, rmw_destroy_wait_set(wait_set)) << rmw_get_error_string().str;
+    for (rmw_guard_condition_t * guard_condition : guard_conditions) {
+      EXPECT_EQ(RMW_RET_OK, rmw_destroy_guard_condition(guard_condition)) <<
+        rmw_get_error_string().str;
+    }
+  }
+}
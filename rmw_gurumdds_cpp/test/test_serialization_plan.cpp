@@ -0,0 +1,826 @@
+// Copyright 2019 GurumNetworks, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "rosidl_runtime_c/primitives_sequence_functions.h"
+#include "rosidl_runtime_c/string_functions.h"
+#include "rosidl_runtime_c/u16string_functions.h"
+#include "rosidl_typesupport_introspection_c/field_types.h"
+#include "rosidl_typesupport_introspection_c/identifier.h"
+#include "rosidl_typesupport_introspection_c/message_introspection.h"
+
+#include "type_support_common.hpp"
+
+using rosidl_typesupport_introspection_cpp::MessageMember;
+using rosidl_typesupport_introspection_cpp::MessageMembers;
+using rosidl_typesupport_introspection_cpp::typesupport_identifier;
+
+namespace
+{
+struct Point
+{
+  double x, y, z;
+};
+
+struct Quaternion
+{
+  double x, y, z, w;
+};
+
+struct Pose
+{
+  Point position;
+  Quaternion orientation;
+};
+
+struct PoseArray
+{
+  std::string frame_id;
+  std::vector<Pose> poses;
+  int32_t seq;
+  int16_t a;
+  int16_t b;
+  uint8_t c;
+  double covariance[3];
+  bool valid;
+  std::vector<double> weights;
+  Pose origin;
+};
+
+struct Tag
+{
+  uint8_t kind;
+  std::string name;
+  int16_t code;
+};
+
+struct TagList
+{
+  Tag fixed[3];
+  std::vector<Tag> tags;
+  uint8_t tail;
+};
+
+template<typename T>
+size_t vector_size(const void * untyped_vector)
+{
+  return static_cast<const std::vector<T> *>(untyped_vector)->size();
+}
+
+template<typename T>
+const void * vector_get_const(const void * untyped_vector, size_t index)
+{
+  return &(*static_cast<const std::vector<T> *>(untyped_vector))[index];
+}
+
+template<typename T>
+void * vector_get(void * untyped_vector, size_t index)
+{
+  return &(*static_cast<std::vector<T> *>(untyped_vector))[index];
+}
+
+template<typename T>
+void vector_resize(void * untyped_vector, size_t size)
+{
+  static_cast<std::vector<T> *>(untyped_vector)->resize(size);
+}
+
+size_t covariance_size(const void *)
+{
+  return 3;
+}
+
+const void * covariance_get_const(const void * untyped_array, size_t index)
+{
+  return static_cast<const double *>(untyped_array) + index;
+}
+
+void * covariance_get(void * untyped_array, size_t index)
+{
+  return static_cast<double *>(untyped_array) + index;
+}
+
+size_t tag_array_size(const void *)
+{
+  return 3;
+}
+
+const void * tag_array_get_const(const void * untyped_array, size_t index)
+{
+  return static_cast<const Tag *>(untyped_array) + index;
+}
+
+void * tag_array_get(void * untyped_array, size_t index)
+{
+  return static_cast<Tag *>(untyped_array) + index;
+}
+
+MessageMember make_member(const char * name, uint8_t type_id, size_t offset)
+{
+  MessageMember member{};
+  member.name_ = name;
+  member.type_id_ = type_id;
+  member.offset_ = static_cast<uint32_t>(offset);
+  return member;
+}
+
+template<typename T>
+void make_sequence(MessageMember & member)
+{
+  member.is_array_ = true;
+  member.size_function = vector_size<T>;
+  member.get_const_function = vector_get_const<T>;
+  member.get_function = vector_get<T>;
+  member.resize_function = vector_resize<T>;
+}
+
+PoseArray make_message(size_t pose_count)
+{
+  PoseArray message;
+  message.frame_id = "map";
+  for (size_t i = 0; i < pose_count; i++) {
+    double v = static_cast<double>(i);
+    message.poses.push_back(Pose{{v, 2 * v, 3 * v}, {0.0, 0.0, v, 1.0}});
+  }
+  message.seq = 7;
+  message.a = -2;
+  message.b = 3;
+  message.c = 9;
+  message.covariance[0] = 1.0;
+  message.covariance[1] = 2.0;
+  message.covariance[2] = 3.0;
+  message.valid = true;
+  message.weights = {4.5, 6.5};
+  message.origin = Pose{{9.0, 8.0, 7.0}, {6.0, 5.0, 4.0, 3.0}};
+  return message;
+}
+
+MessageMembers make_members(
+  const char * name, size_t size_of, const MessageMember * members, uint32_t count)
+{
+  MessageMembers message_members{};
+  message_members.message_namespace_ = "test_msgs__msg";
+  message_members.message_name_ = name;
+  message_members.member_count_ = count;
+  message_members.size_of_ = size_of;
+  message_members.members_ = members;
+  return message_members;
+}
+
+rosidl_message_type_support_t make_type_support(const MessageMembers * members)
+{
+  rosidl_message_type_support_t type_support{};
+  type_support.typesupport_identifier = typesupport_identifier;
+  type_support.data = members;
+  return type_support;
+}
+
+// Hand-written introspection data for geometry_msgs-like types, so the plan can be checked
+// against MessageSerializer without generated type supports. Plans are cached by the address
+// of the members, so the data lives as long as the process.
+struct TestTypes
+{
+  TestTypes()
+  {
+    point_members_ = {
+      make_member("x", rosidl_typesupport_introspection_cpp::ROS_TYPE_DOUBLE, 0),
+      make_member("y", rosidl_typesupport_introspection_cpp::ROS_TYPE_DOUBLE, 8),
+      make_member("z", rosidl_typesupport_introspection_cpp::ROS_TYPE_DOUBLE, 16),
+    };
+    point_ = make_members("Point", sizeof(Point), point_members_.data(), 3);
+    point_ts_ = make_type_support(&point_);
+
+    quaternion_members_ = {
+      make_member("x", rosidl_typesupport_introspection_cpp::ROS_TYPE_DOUBLE, 0),
+      make_member("y", rosidl_typesupport_introspection_cpp::ROS_TYPE_DOUBLE, 8),
+      make_member("z", rosidl_typesupport_introspection_cpp::ROS_TYPE_DOUBLE, 16),
+      make_member("w", rosidl_typesupport_introspection_cpp::ROS_TYPE_DOUBLE, 24),
+    };
+    quaternion_ = make_members("Quaternion", sizeof(Quaternion), quaternion_members_.data(), 4);
+    quaternion_ts_ = make_type_support(&quaternion_);
+
+    pose_members_ = {
+      make_member(
+        "position", rosidl_typesupport_introspection_cpp::ROS_TYPE_MESSAGE,
+        offsetof(Pose, position)),
+      make_member(
+        "orientation", rosidl_typesupport_introspection_cpp::ROS_TYPE_MESSAGE,
+        offsetof(Pose, orientation)),
+    };
+    pose_members_[0].members_ = &point_ts_;
+    pose_members_[1].members_ = &quaternion_ts_;
+    pose_ = make_members("Pose", sizeof(Pose), pose_members_.data(), 2);
+    pose_ts_ = make_type_support(&pose_);
+
+    using rosidl_typesupport_introspection_cpp::ROS_TYPE_BOOLEAN;
+    using rosidl_typesupport_introspection_cpp::ROS_TYPE_DOUBLE;
+    using rosidl_typesupport_introspection_cpp::ROS_TYPE_INT16;
+    using rosidl_typesupport_introspection_cpp::ROS_TYPE_INT32;
+    using rosidl_typesupport_introspection_cpp::ROS_TYPE_MESSAGE;
+    using rosidl_typesupport_introspection_cpp::ROS_TYPE_STRING;
+    using rosidl_typesupport_introspection_cpp::ROS_TYPE_UINT8;
+    pose_array_members_ = {
+      make_member("frame_id", ROS_TYPE_STRING, offsetof(PoseArray, frame_id)),
+      make_member("poses", ROS_TYPE_MESSAGE, offsetof(PoseArray, poses)),
+      make_member("seq", ROS_TYPE_INT32, offsetof(PoseArray, seq)),
+      make_member("a", ROS_TYPE_INT16, offsetof(PoseArray, a)),
+      make_member("b", ROS_TYPE_INT16, offsetof(PoseArray, b)),
+      make_member("c", ROS_TYPE_UINT8, offsetof(PoseArray, c)),
+      make_member("covariance", ROS_TYPE_DOUBLE, offsetof(PoseArray, covariance)),
+      make_member("valid", ROS_TYPE_BOOLEAN, offsetof(PoseArray, valid)),
+      make_member("weights", ROS_TYPE_DOUBLE, offsetof(PoseArray, weights)),
+      make_member("origin", ROS_TYPE_MESSAGE, offsetof(PoseArray, origin)),
+    };
+    pose_array_members_[1].members_ = &pose_ts_;
+    make_sequence<Pose>(pose_array_members_[1]);
+    pose_array_members_[6].is_array_ = true;
+    pose_array_members_[6].array_size_ = 3;
+    pose_array_members_[6].size_function = covariance_size;
+    pose_array_members_[6].get_const_function = covariance_get_const;
+    pose_array_members_[6].get_function = covariance_get;
+    make_sequence<double>(pose_array_members_[8]);
+    pose_array_members_[9].members_ = &pose_ts_;
+    pose_array_ = make_members(
+      "PoseArray", sizeof(PoseArray), pose_array_members_.data(),
+      static_cast<uint32_t>(pose_array_members_.size()));
+
+    // Same layout with every string and sequence bounded
+    bounded_pose_array_members_ = pose_array_members_;
+    bounded_pose_array_members_[0].string_upper_bound_ = 10;
+    bounded_pose_array_members_[1].array_size_ = 5;
+    bounded_pose_array_members_[1].is_upper_bound_ = true;
+    bounded_pose_array_members_[8].array_size_ = 2;
+    bounded_pose_array_members_[8].is_upper_bound_ = true;
+    bounded_pose_array_ = make_members(
+      "BoundedPoseArray", sizeof(PoseArray), bounded_pose_array_members_.data(),
+      static_cast<uint32_t>(bounded_pose_array_members_.size()));
+
+    // Elements whose size changes their alignment, in a fixed array and a bounded sequence
+    tag_members_ = {
+      make_member("kind", ROS_TYPE_UINT8, offsetof(Tag, kind)),
+      make_member("name", ROS_TYPE_STRING, offsetof(Tag, name)),
+      make_member("code", ROS_TYPE_INT16, offsetof(Tag, code)),
+    };
+    tag_members_[1].string_upper_bound_ = 3;
+    tag_ = make_members("Tag", sizeof(Tag), tag_members_.data(), 3);
+    tag_ts_ = make_type_support(&tag_);
+
+    tag_list_members_ = {
+      make_member("fixed", ROS_TYPE_MESSAGE, offsetof(TagList, fixed)),
+      make_member("tags", ROS_TYPE_MESSAGE, offsetof(TagList, tags)),
+      make_member("tail", ROS_TYPE_UINT8, offsetof(TagList, tail)),
+    };
+    tag_list_members_[0].members_ = &tag_ts_;
+    tag_list_members_[0].is_array_ = true;
+    tag_list_members_[0].array_size_ = 3;
+    tag_list_members_[0].size_function = tag_array_size;
+    tag_list_members_[0].get_const_function = tag_array_get_const;
+    tag_list_members_[0].get_function = tag_array_get;
+    tag_list_members_[1].members_ = &tag_ts_;
+    make_sequence<Tag>(tag_list_members_[1]);
+    tag_list_members_[1].array_size_ = 4;
+    tag_list_members_[1].is_upper_bound_ = true;
+    tag_list_ = make_members("TagList", sizeof(TagList), tag_list_members_.data(), 3);
+  }
+
+  std::vector<MessageMember> point_members_;
+  MessageMembers point_;
+  rosidl_message_type_support_t point_ts_;
+  std::vector<MessageMember> quaternion_members_;
+  MessageMembers quaternion_;
+  rosidl_message_type_support_t quaternion_ts_;
+  std::vector<MessageMember> pose_members_;
+  MessageMembers pose_;
+  rosidl_message_type_support_t pose_ts_;
+  std::vector<MessageMember> pose_array_members_;
+  MessageMembers pose_array_;
+  std::vector<MessageMember> bounded_pose_array_members_;
+  MessageMembers bounded_pose_array_;
+  std::vector<MessageMember> tag_members_;
+  MessageMembers tag_;
+  rosidl_message_type_support_t tag_ts_;
+  std::vector<MessageMember> tag_list_members_;
+  MessageMembers tag_list_;
+};
+
+const TestTypes & test_types()
+{
+  static TestTypes types;
+  return types;
+}
+}  // namespace
+
+TEST(TestSerializationPlan, plan_matches_introspection) {
+  const TestTypes & types = test_types();
+  auto plan = create_serialization_plan(&types.pose_array_, typesupport_identifier);
+  ASSERT_NE(nullptr, plan);
+  EXPECT_FALSE(plan->is_fixed_size());
+  EXPECT_EQ(0u, plan->get_plain_size());
+  EXPECT_EQ(0u, plan->get_max_serialized_size());
+
+  PoseArray message = make_message(5);
+  std::vector<uint8_t> expected;
+  size_t expected_size = 0;
+  ASSERT_TRUE(
+    serialize_ros_to_cdr(
+      &types.pose_array_, typesupport_identifier, &message, expected, &expected_size));
+  EXPECT_EQ(
+    static_cast<ssize_t>(expected_size),
+    get_serialized_size(&types.pose_array_, typesupport_identifier, &message));
+
+  std::vector<uint8_t> actual;
+  size_t actual_size = 0;
+  ASSERT_TRUE(
+    serialize_ros_to_cdr(
+      &types.pose_array_, typesupport_identifier, &message, actual, &actual_size, plan.get()));
+  ASSERT_EQ(expected_size, actual_size);
+  EXPECT_EQ(0, memcmp(expected.data(), actual.data(), expected_size));
+
+  // The fixed-buffer overload writes the same bytes and refuses a buffer that is too small
+  std::vector<uint8_t> fixed(expected_size);
+  size_t fixed_size = 0;
+  ASSERT_TRUE(
+    serialize_ros_to_cdr(
+      &types.pose_array_, typesupport_identifier, &message, fixed.data(), fixed.size(), &fixed_size,
+      plan.get()));
+  ASSERT_EQ(expected_size, fixed_size);
+  EXPECT_EQ(0, memcmp(expected.data(), fixed.data(), expected_size));
+  EXPECT_FALSE(
+    serialize_ros_to_cdr(
+      &types.pose_array_, typesupport_identifier, &message, fixed.data(), fixed.size() - 4,
+      &fixed_size, plan.get()));
+  rmw_reset_error();
+}
+
+TEST(TestSerializationPlan, plan_round_trip) {
+  const TestTypes & types = test_types();
+  auto plan = create_serialization_plan(&types.pose_array_, typesupport_identifier);
+  ASSERT_NE(nullptr, plan);
+
+  PoseArray message = make_message(3);
+  std::vector<uint8_t> buffer;
+  size_t size = 0;
+  ASSERT_TRUE(
+    serialize_ros_to_cdr(
+      &types.pose_array_, typesupport_identifier, &message, buffer, &size, plan.get()));
+
+  // Deserializing into a message that already holds data reuses and trims its storage
+  PoseArray output = make_message(8);
+  output.frame_id = "a much longer frame id";
+  ASSERT_TRUE(
+    deserialize_cdr_to_ros(
+      &types.pose_array_, typesupport_identifier, &output, buffer.data(), size, plan.get()));
+  EXPECT_EQ(message.frame_id, output.frame_id);
+  ASSERT_EQ(message.poses.size(), output.poses.size());
+  for (size_t i = 0; i < message.poses.size(); i++) {
+    EXPECT_EQ(message.poses[i].position.z, output.poses[i].position.z);
+    EXPECT_EQ(message.poses[i].orientation.w, output.poses[i].orientation.w);
+  }
+  EXPECT_EQ(message.seq, output.seq);
+  EXPECT_EQ(message.a, output.a);
+  EXPECT_EQ(message.b, output.b);
+  EXPECT_EQ(message.c, output.c);
+  EXPECT_EQ(message.covariance[2], output.covariance[2]);
+  EXPECT_EQ(message.valid, output.valid);
+  EXPECT_EQ(message.weights, output.weights);
+  EXPECT_EQ(message.origin.orientation.x, output.origin.orientation.x);
+}
+
+TEST(TestSerializationPlan, plain_fast_path) {
+  const TestTypes & types = test_types();
+  auto plan = create_serialization_plan(&types.pose_, typesupport_identifier);
+  ASSERT_NE(nullptr, plan);
+  EXPECT_TRUE(plan->is_fixed_size());
+  EXPECT_EQ(sizeof(Pose), plan->get_plain_size());
+  EXPECT_EQ(sizeof(Pose), plan->get_message_size());
+  EXPECT_EQ(CDR_HEADER_SIZE + sizeof(Pose), plan->get_fixed_serialized_size());
+  EXPECT_EQ(plan->get_fixed_serialized_size(), plan->get_max_serialized_size());
+
+  // Plans are cached per type
+  EXPECT_EQ(plan, create_serialization_plan(&types.pose_, typesupport_identifier));
+
+  Pose pose{{1.0, 2.0, 3.0}, {4.0, 5.0, 6.0, 7.0}};
+  std::vector<uint8_t> expected;
+  size_t expected_size = 0;
+  ASSERT_TRUE(
+    serialize_ros_to_cdr(&types.pose_, typesupport_identifier, &pose, expected, &expected_size));
+  ASSERT_EQ(plan->get_fixed_serialized_size(), expected_size);
+  EXPECT_EQ(0, memcmp(expected.data() + CDR_HEADER_SIZE, &pose, sizeof(Pose)));
+
+  std::vector<uint8_t> actual(plan->get_fixed_serialized_size());
+  size_t actual_size = 0;
+  ASSERT_TRUE(
+    serialize_ros_to_cdr(
+      &types.pose_, typesupport_identifier, &pose, actual.data(), actual.size(), &actual_size,
+      plan.get()));
+  ASSERT_EQ(expected_size, actual_size);
+  EXPECT_EQ(0, memcmp(expected.data(), actual.data(), expected_size));
+
+  Pose output{};
+  ASSERT_TRUE(
+    deserialize_cdr_to_ros(
+      &types.pose_, typesupport_identifier, &output, actual.data(), actual_size, plan.get()));
+  EXPECT_EQ(0, memcmp(&pose, &output, sizeof(Pose)));
+}
+
+TEST(TestSerializationPlan, bounded_max_serialized_size) {
+  const TestTypes & types = test_types();
+  auto plan = create_serialization_plan(&types.bounded_pose_array_, typesupport_identifier);
+  ASSERT_NE(nullptr, plan);
+  size_t max_size = plan->get_max_serialized_size();
+  ASSERT_NE(0u, max_size);
+
+  size_t worst = 0;
+  for (size_t frame_length = 0; frame_length <= 10; frame_length++) {
+    for (size_t pose_count = 0; pose_count <= 5; pose_count++) {
+      for (size_t weight_count = 0; weight_count <= 2; weight_count++) {
+        PoseArray message = make_message(pose_count);
+        message.frame_id = std::string(frame_length, 'x');
+        message.weights.resize(weight_count);
+
+        std::vector<uint8_t> buffer(max_size);
+        size_t size = 0;
+        ASSERT_TRUE(
+          serialize_ros_to_cdr(
+            &types.bounded_pose_array_, typesupport_identifier, &message, buffer.data(),
+            buffer.size(), &size, plan.get()));
+        worst = std::max(worst, size);
+      }
+    }
+  }
+  EXPECT_EQ(worst, max_size);
+}
+
+// Not a pass/fail check; records per-message cost of both paths in the test results
+TEST(TestSerializationPlan, benchmark_plan_against_introspection) {
+  const TestTypes & types = test_types();
+  auto plan = create_serialization_plan(&types.pose_array_, typesupport_identifier);
+  ASSERT_NE(nullptr, plan);
+
+  constexpr int iterations = 2000;
+  PoseArray message = make_message(1000);
+  std::vector<uint8_t> buffer;
+  size_t size = 0;
+
+  auto measure = [&](const SerializationPlan * p) {
+      auto start = std::chrono::steady_clock::now();
+      for (int i = 0; i < iterations; i++) {
+        if (!serialize_ros_to_cdr(
+            &types.pose_array_, typesupport_identifier, &message, buffer, &size, p))
+        {
+          return int64_t{-1};
+        }
+      }
+      auto elapsed = std::chrono::steady_clock::now() - start;
+      return static_cast<int64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count() / iterations);
+    };
+
+  int64_t introspection_ns = measure(nullptr);
+  int64_t plan_ns = measure(plan.get());
+  ASSERT_GE(introspection_ns, 0);
+  ASSERT_GE(plan_ns, 0);
+  RecordProperty("introspection_ns_per_message", std::to_string(introspection_ns));
+  RecordProperty("plan_ns_per_message", std::to_string(plan_ns));
+}
+
+// Every name length of every element, so the largest serialized message is among them
+static void max_tag_list_size(
+  const TestTypes & types, const SerializationPlan * plan, TagList & message, size_t index,
+  size_t & worst)
+{
+  if (index == 3 + message.tags.size()) {
+    std::vector<uint8_t> buffer(plan->get_max_serialized_size());
+    size_t size = 0;
+    ASSERT_TRUE(
+      serialize_ros_to_cdr(
+        &types.tag_list_, typesupport_identifier, &message, buffer.data(), buffer.size(), &size,
+        plan));
+    worst = std::max(worst, size);
+    return;
+  }
+  Tag & tag = index < 3 ? message.fixed[index] : message.tags[index - 3];
+  for (size_t length = 0; length <= 3; length++) {
+    tag.name = std::string(length, 'x');
+    max_tag_list_size(types, plan, message, index + 1, worst);
+  }
+}
+
+TEST(TestSerializationPlan, bounded_struct_arrays) {
+  const TestTypes & types = test_types();
+  auto plan = create_serialization_plan(&types.tag_list_, typesupport_identifier);
+  ASSERT_NE(nullptr, plan);
+  ASSERT_NE(0u, plan->get_max_serialized_size());
+
+  size_t worst = 0;
+  for (size_t tag_count = 0; tag_count <= 4; tag_count++) {
+    TagList message{};
+    message.tags.resize(tag_count);
+    max_tag_list_size(types, plan.get(), message, 0, worst);
+  }
+  EXPECT_EQ(worst, plan->get_max_serialized_size());
+}
+
+namespace
+{
+struct CPoint
+{
+  double x, y;
+};
+
+struct CPoint__Sequence
+{
+  CPoint * data;
+  size_t size;
+  size_t capacity;
+};
+
+struct CScan
+{
+  rosidl_runtime_c__String frame_id;
+  rosidl_runtime_c__U16String label;
+  rosidl_runtime_c__uint32__Sequence ranges;
+  rosidl_runtime_c__String__Sequence names;
+  CPoint__Sequence points;
+};
+
+size_t c_points_size(const void * untyped_sequence)
+{
+  return static_cast<const CPoint__Sequence *>(untyped_sequence)->size;
+}
+
+const void * c_points_get_const(const void * untyped_sequence, size_t index)
+{
+  return &static_cast<const CPoint__Sequence *>(untyped_sequence)->data[index];
+}
+
+void * c_points_get(void * untyped_sequence, size_t index)
+{
+  return &static_cast<CPoint__Sequence *>(untyped_sequence)->data[index];
+}
+
+// Reallocates like a generated __Sequence__fini and __init pair
+bool c_points_resize(void * untyped_sequence, size_t size)
+{
+  auto sequence = static_cast<CPoint__Sequence *>(untyped_sequence);
+  free(sequence->data);
+  sequence->data = static_cast<CPoint *>(calloc(size == 0 ? 1 : size, sizeof(CPoint)));
+  sequence->size = sequence->data != nullptr ? size : 0;
+  sequence->capacity = sequence->size;
+  return sequence->data != nullptr;
+}
+
+bool c_points_fail_resize(void *, size_t)
+{
+  return false;
+}
+
+rosidl_typesupport_introspection_c__MessageMember make_c_member(
+  const char * name, uint8_t type_id, size_t offset)
+{
+  rosidl_typesupport_introspection_c__MessageMember member{};
+  member.name_ = name;
+  member.type_id_ = type_id;
+  member.offset_ = static_cast<uint32_t>(offset);
+  return member;
+}
+
+struct CTestTypes
+{
+  CTestTypes()
+  {
+    point_members_ = {
+      make_c_member("x", rosidl_typesupport_introspection_c__ROS_TYPE_DOUBLE, 0),
+      make_c_member("y", rosidl_typesupport_introspection_c__ROS_TYPE_DOUBLE, 8),
+    };
+    point_ = make_c_members("CPoint", sizeof(CPoint), point_members_);
+    point_ts_.typesupport_identifier = rosidl_typesupport_introspection_c__identifier;
+    point_ts_.data = &point_;
+
+    scan_members_ = {
+      make_c_member(
+        "frame_id", rosidl_typesupport_introspection_c__ROS_TYPE_STRING, offsetof(CScan, frame_id)),
+      make_c_member(
+        "label", rosidl_typesupport_introspection_c__ROS_TYPE_WSTRING, offsetof(CScan, label)),
+      make_c_member(
+        "ranges", rosidl_typesupport_introspection_c__ROS_TYPE_UINT32, offsetof(CScan, ranges)),
+      make_c_member(
+        "names", rosidl_typesupport_introspection_c__ROS_TYPE_STRING, offsetof(CScan, names)),
+      make_c_member(
+        "points", rosidl_typesupport_introspection_c__ROS_TYPE_MESSAGE, offsetof(CScan, points)),
+    };
+    scan_members_[2].is_array_ = true;
+    scan_members_[3].is_array_ = true;
+    scan_members_[4].is_array_ = true;
+    scan_members_[4].members_ = &point_ts_;
+    scan_members_[4].size_function = c_points_size;
+    scan_members_[4].get_const_function = c_points_get_const;
+    scan_members_[4].get_function = c_points_get;
+    scan_members_[4].resize_function = c_points_resize;
+    scan_ = make_c_members("CScan", sizeof(CScan), scan_members_);
+
+    // Same layout with a sequence that cannot be resized
+    failing_scan_members_ = scan_members_;
+    failing_scan_members_[4].resize_function = c_points_fail_resize;
+    failing_scan_ = make_c_members("FailingCScan", sizeof(CScan), failing_scan_members_);
+  }
+
+  static rosidl_typesupport_introspection_c__MessageMembers make_c_members(
+    const char * name, size_t size_of,
+    const std::vector<rosidl_typesupport_introspection_c__MessageMember> & members)
+  {
+    rosidl_typesupport_introspection_c__MessageMembers message_members{};
+    message_members.message_namespace_ = "test_msgs__msg";
+    message_members.message_name_ = name;
+    message_members.member_count_ = static_cast<uint32_t>(members.size());
+    message_members.size_of_ = size_of;
+    message_members.members_ = members.data();
+    return message_members;
+  }
+
+  std::vector<rosidl_typesupport_introspection_c__MessageMember> point_members_;
+  rosidl_typesupport_introspection_c__MessageMembers point_;
+  rosidl_message_type_support_t point_ts_{};
+  std::vector<rosidl_typesupport_introspection_c__MessageMember> scan_members_;
+  rosidl_typesupport_introspection_c__MessageMembers scan_;
+  std::vector<rosidl_typesupport_introspection_c__MessageMember> failing_scan_members_;
+  rosidl_typesupport_introspection_c__MessageMembers failing_scan_;
+};
+
+const CTestTypes & c_test_types()
+{
+  static CTestTypes types;
+  return types;
+}
+
+void init_c_scan(CScan & scan, size_t count, const char * frame_id, size_t label_length)
+{
+  memset(&scan, 0, sizeof(CScan));
+  ASSERT_TRUE(rosidl_runtime_c__String__init(&scan.frame_id));
+  ASSERT_TRUE(rosidl_runtime_c__String__assignn(&scan.frame_id, frame_id, strlen(frame_id)));
+  ASSERT_TRUE(rosidl_runtime_c__U16String__init(&scan.label));
+  ASSERT_TRUE(rosidl_runtime_c__U16String__resize(&scan.label, label_length));
+  for (size_t i = 0; i < label_length; i++) {
+    scan.label.data[i] = static_cast<uint16_t>(u'a' + i);
+  }
+  ASSERT_TRUE(rosidl_runtime_c__uint32__Sequence__init(&scan.ranges, count));
+  ASSERT_TRUE(rosidl_runtime_c__String__Sequence__init(&scan.names, count));
+  ASSERT_TRUE(c_points_resize(&scan.points, count));
+  for (size_t i = 0; i < count; i++) {
+    std::string name(i + 1, static_cast<char>('a' + i));
+    scan.ranges.data[i] = static_cast<uint32_t>(i * 10);
+    ASSERT_TRUE(
+      rosidl_runtime_c__String__assignn(&scan.names.data[i], name.c_str(), name.size()));
+    scan.points.data[i] = CPoint{static_cast<double>(i), static_cast<double>(2 * i)};
+  }
+}
+
+void fini_c_scan(CScan & scan)
+{
+  rosidl_runtime_c__String__fini(&scan.frame_id);
+  rosidl_runtime_c__U16String__fini(&scan.label);
+  rosidl_runtime_c__uint32__Sequence__fini(&scan.ranges);
+  rosidl_runtime_c__String__Sequence__fini(&scan.names);
+  free(scan.points.data);
+}
+
+void expect_c_scan_eq(const CScan & expected, const CScan & actual)
+{
+  EXPECT_STREQ(expected.frame_id.data, actual.frame_id.data);
+  EXPECT_EQ(expected.frame_id.size, actual.frame_id.size);
+  ASSERT_EQ(expected.label.size, actual.label.size);
+  EXPECT_EQ(
+    0, memcmp(expected.label.data, actual.label.data, expected.label.size * sizeof(uint16_t)));
+  EXPECT_EQ(u'\0', actual.label.data[actual.label.size]);
+  ASSERT_EQ(expected.ranges.size, actual.ranges.size);
+  ASSERT_EQ(expected.names.size, actual.names.size);
+  ASSERT_EQ(expected.points.size, actual.points.size);
+  for (size_t i = 0; i < expected.ranges.size; i++) {
+    EXPECT_EQ(expected.ranges.data[i], actual.ranges.data[i]);
+    EXPECT_STREQ(expected.names.data[i].data, actual.names.data[i].data);
+    EXPECT_EQ(expected.points.data[i].y, actual.points.data[i].y);
+  }
+}
+}  // namespace
+
+// A C message taken repeatedly keeps the storage of its sequences and strings while it fits
+TEST(TestSerializationPlan, c_round_trip_reuses_storage) {
+  const CTestTypes & types = c_test_types();
+  const char * identifier = rosidl_typesupport_introspection_c__identifier;
+  const rosidl_typesupport_introspection_c__MessageMembers * members = &types.scan_;
+  auto plan = create_serialization_plan(members, identifier);
+  ASSERT_NE(nullptr, plan);
+
+  const SerializationPlan * plans[] = {nullptr, plan.get()};
+  for (const SerializationPlan * p : plans) {
+    CScan large;
+    CScan small;
+    init_c_scan(large, 6, "a long frame id", 8);
+    init_c_scan(small, 2, "map", 3);
+
+    std::vector<uint8_t> large_buffer;
+    std::vector<uint8_t> small_buffer;
+    size_t large_size = 0;
+    size_t small_size = 0;
+    ASSERT_TRUE(serialize_ros_to_cdr(members, identifier, &large, large_buffer, &large_size, p));
+    ASSERT_TRUE(serialize_ros_to_cdr(members, identifier, &small, small_buffer, &small_size, p));
+
+    CScan output;
+    memset(&output, 0, sizeof(CScan));
+    ASSERT_TRUE(
+      deserialize_cdr_to_ros(members, identifier, &output, large_buffer.data(), large_size, p));
+    expect_c_scan_eq(large, output);
+
+    const char * frame_id_data = output.frame_id.data;
+    size_t frame_id_capacity = output.frame_id.capacity;
+    const uint16_t * label_data = output.label.data;
+    const uint32_t * ranges_data = output.ranges.data;
+    const rosidl_runtime_c__String * names_data = output.names.data;
+    const char * last_name_data = output.names.data[5].data;
+    const CPoint * points_data = output.points.data;
+
+    // Shrinking keeps every buffer and the capacity the sequences are freed up to
+    ASSERT_TRUE(
+      deserialize_cdr_to_ros(members, identifier, &output, small_buffer.data(), small_size, p));
+    expect_c_scan_eq(small, output);
+    EXPECT_EQ(frame_id_data, output.frame_id.data);
+    EXPECT_EQ(frame_id_capacity, output.frame_id.capacity);
+    EXPECT_EQ(label_data, output.label.data);
+    EXPECT_EQ(ranges_data, output.ranges.data);
+    EXPECT_EQ(6u, output.ranges.capacity);
+    EXPECT_EQ(names_data, output.names.data);
+    EXPECT_EQ(6u, output.names.capacity);
+    EXPECT_EQ(last_name_data, output.names.data[5].data);
+    EXPECT_EQ(points_data, output.points.data);
+
+    // Growing back within the capacity still reuses them
+    ASSERT_TRUE(
+      deserialize_cdr_to_ros(members, identifier, &output, large_buffer.data(), large_size, p));
+    expect_c_scan_eq(large, output);
+    EXPECT_EQ(frame_id_data, output.frame_id.data);
+    EXPECT_EQ(label_data, output.label.data);
+    EXPECT_EQ(ranges_data, output.ranges.data);
+    EXPECT_EQ(names_data, output.names.data);
+    EXPECT_EQ(points_data, output.points.data);
+
+    fini_c_scan(output);
+    fini_c_scan(small);
+    fini_c_scan(large);
+  }
+}
+
+// Both introspection flavours report a sequence that could not be resized the same way
+TEST(TestSerializationPlan, resize_failure) {
+  const CTestTypes & c_types = c_test_types();
+  const char * c_identifier = rosidl_typesupport_introspection_c__identifier;
+  CScan scan;
+  init_c_scan(scan, 2, "map", 3);
+  std::vector<uint8_t> c_buffer;
+  size_t c_size = 0;
+  ASSERT_TRUE(serialize_ros_to_cdr(&c_types.scan_, c_identifier, &scan, c_buffer, &c_size));
+  CScan c_output;
+  memset(&c_output, 0, sizeof(CScan));
+  EXPECT_FALSE(
+    deserialize_cdr_to_ros(
+      &c_types.failing_scan_, c_identifier, &c_output, c_buffer.data(), c_size));
+  rmw_reset_error();
+  fini_c_scan(c_output);
+  fini_c_scan(scan);
+
+  // A C++ resize function that leaves the size unchanged counts as a failure
+  const TestTypes & types = test_types();
+  std::vector<MessageMember> members = types.pose_array_members_;
+  members[8].resize_function = [](void *, size_t) {};
+  MessageMembers failing = make_members(
+    "FailingPoseArray", sizeof(PoseArray), members.data(), static_cast<uint32_t>(members.size()));
+  PoseArray message = make_message(1);
+  std::vector<uint8_t> buffer;
+  size_t size = 0;
+  ASSERT_TRUE(
+    serialize_ros_to_cdr(&types.pose_array_, typesupport_identifier, &message, buffer, &size));
+  PoseArray output{};
+  EXPECT_FALSE(
+    deserialize_cdr_to_ros(&failing, typesupport_identifier, &output, buffer.data(), size));
+  rmw_reset_error();
+}